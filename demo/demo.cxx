@@ -5,16 +5,16 @@ auto demo_t::draw_menu(draw::scene_t& scene, timer_t& timer) -> void
 	// menu background
 	scene.mesh(
 		rect_t(
-			window::res_vec.m_x - m_bar - 5,
+			m_resolution.m_x - m_bar - 5,
 			0,
 			m_bar + 5,
-			window::res_vec.m_y
+			m_resolution.m_y
 		),
 		color_t{35, 35, 35, 255}
 	);
 
 	// main menu button
-	if (scene.button(rect_t(window::res_vec.m_x - m_bar, window::res_vec.m_y - 45, 195, 35), "Main menu", 16))
+	if (scene.button(rect_t(m_resolution.m_x - m_bar, m_resolution.m_y - 45, 195, 35), "Main menu", 16))
 		m_ui_state = menu_state::main;
 
 	// render debug info
@@ -23,16 +23,40 @@ auto demo_t::draw_menu(draw::scene_t& scene, timer_t& timer) -> void
 
 auto demo_t::main(draw::scene_t& scene, timer_t& timer) -> void
 {
-	scene.text(vertex_t(window::center.m_x, 200, color_t{255, 255, 255, 255}), "Main menu", 24.0f, 1);
+	scene.text(vertex_t(m_center.m_x, 200, color_t{255, 255, 255, 255}), "Main menu", 24.0f, 1);
 
-	if (scene.button(rect_t(window::center.m_x, 250, 400, 50), "Mesh drawing", 18, 0, 1))
+	if (scene.button(rect_t(m_center.m_x, 250, 400, 50), "Mesh drawing", 18, 0, 1))
 		m_ui_state = menu_state::example_1;
 
-	else if (scene.button(rect_t(window::center.m_x, 305, 400, 50), "Rendering circles", 18, 0, 1))
+	else if (scene.button(rect_t(m_center.m_x, 305, 400, 50), "Rendering circles", 18, 0, 1))
 		m_ui_state = menu_state::example_2;
 
-	else if (scene.button(rect_t(window::center.m_x, 360, 400, 50), "Circular motion illusion", 18, 0, 1))
+	else if (scene.button(rect_t(m_center.m_x, 360, 400, 50), "Circular motion illusion", 18, 0, 1))
 		m_ui_state = menu_state::example_3;
+
+	// presentation settings, the label shows the mode the driver actually gave us
+	constexpr auto mode_names = std::array<const char*, 3>{"fifo", "mailbox", "immediate"};
+	auto mode = static_cast<std::uint32_t>(scene.get_present_mode());
+
+	if (scene.button(rect_t(m_center.m_x, 440, 400, 50), std::string{"Present mode: "} + mode_names.at(mode), 18, 0, 1))
+	{
+		// step through the requested modes, an unsupported one would fall back to where we came from
+		m_present_mode = static_cast<present_mode>((static_cast<std::uint32_t>(m_present_mode) + 1) % mode_names.size());
+		scene.set_present_mode(m_present_mode);
+	}
+
+	if (scene.button(rect_t(m_center.m_x, 495, 400, 50), timer.get_frame_limit() ? "Frame limit: " + std::to_string(timer.get_frame_limit()) : "Frame limit: off", 18, 0, 1))
+	{
+		m_frame_limit = (m_frame_limit + 1) % draw::settings::present::frame_limits.size();
+		timer.set_frame_limit(draw::settings::present::frame_limits.at(m_frame_limit));
+	}
+
+	auto scale = static_cast<std::int32_t>(std::roundf(scene.get_render_scale() * 100.0f));
+	if (scene.button(rect_t(m_center.m_x, 550, 400, 50), m_dynamic_resolution ? "Dynamic resolution: " + std::to_string(scale) + "%" : "Dynamic resolution: off", 18, 0, 1))
+	{
+		m_dynamic_resolution = !m_dynamic_resolution;
+		scene.set_dynamic_resolution(m_dynamic_resolution);
+	}
 }
 
 auto demo_t::example_1(draw::scene_t& scene, timer_t& timer) -> void
@@ -41,26 +65,26 @@ auto demo_t::example_1(draw::scene_t& scene, timer_t& timer) -> void
 
 	// user interface
 	{
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y, 195, 35), m_draw.m_points ? "Point: on" : "Points: off", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y, 195, 35), m_draw.m_points ? "Point: on" : "Points: off", 16))
 			m_draw.m_points = !m_draw.m_points;
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 40, 195, 35), m_draw.m_line ? "Line: on" : "Lines: off", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 40, 195, 35), m_draw.m_line ? "Line: on" : "Lines: off", 16))
 			m_draw.m_line = !m_draw.m_line;
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 40, 195, 35), m_draw.m_mesh ? "Polygons: on" : "Polygons: off", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 40, 195, 35), m_draw.m_mesh ? "Polygons: on" : "Polygons: off", 16))
 			m_draw.m_mesh = !m_draw.m_mesh;
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 40, 195, 35), m_draw.m_rand ? "Random color: on" : "Random color: off", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 40, 195, 35), m_draw.m_rand ? "Random color: on" : "Random color: off", 16))
 			m_draw.m_rand = !m_draw.m_rand;
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 70, 195, 35), "Clear", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 70, 195, 35), "Clear", 16))
 			m_draw.m_vertices.clear();
 	}
 
 
 	
 	// add a point
-	if (auto cursor = scene.get_cursor(); input::key_down(key::lmb, key_flag::pushed) && cursor.m_x < window::res_vec.m_x - 210)
+	if (auto cursor = scene.get_cursor(); input::key_down(key::lmb, key_flag::pushed) && cursor.m_x < m_resolution.m_x - 210)
 	{
 		auto color = m_draw.m_rand ? color_t(::rand() % 256, ::rand() % 256, ::rand() % 256, 255) : color_t{255, 0, 80, 255};
 		m_draw.m_vertices.push_back(vertex_t{cursor.m_x, cursor.m_y, color});
@@ -70,13 +94,13 @@ auto demo_t::example_1(draw::scene_t& scene, timer_t& timer) -> void
 	auto color_override = color_t{255, 255, 255, 255};
 	if (m_draw.m_line) scene.line(m_draw.m_vertices, 2.0f, &color_override);
 
-	// draw meshes
-	if (m_draw.m_mesh) scene.mesh(m_draw.m_vertices);
+	// draw polygons, the outline may be concave or cross itself
+	if (m_draw.m_mesh && !m_draw.m_vertices.empty()) scene.polygon(m_draw.m_vertices, m_draw.m_vertices.front().m_col);
 
 	// draw points
 	if (m_draw.m_points)
 		for (auto vertex : m_draw.m_vertices)
-			scene.circle(vertex, 12, 6, 2.0f, &color_override);
+			scene.ring(vertex_t{vertex.m_pos.m_x, vertex.m_pos.m_y, color_override}, 6.0f, 2.0f);
 }
 
 auto demo_t::example_2(draw::scene_t& scene, timer_t& timer) -> void
@@ -86,74 +110,74 @@ auto demo_t::example_2(draw::scene_t& scene, timer_t& timer) -> void
 	// user interface
 	{ 
 		// controls
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y, 195, 35), m_circle.m_outer ? "Outer: on" : "Outer: off", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y, 195, 35), m_circle.m_outer ? "Outer: on" : "Outer: off", 16))
 			m_circle.m_outer = !m_circle.m_outer;
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 40, 195, 35), m_circle.m_inner ? "Inner: on" : "Inner: off", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 40, 195, 35), m_circle.m_inner ? "Inner: on" : "Inner: off", 16))
 			m_circle.m_inner = !m_circle.m_inner;
 
 		// inner settings
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 40, 195, 35), m_circle.m_inner_lines ? "Inner-lines: on" : "Inner-lines: off", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 40, 195, 35), m_circle.m_inner_lines ? "Inner-lines: on" : "Inner-lines: off", 16))
 			m_circle.m_inner_lines = !m_circle.m_inner_lines;
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 40, 195, 35), m_circle.m_animate ? "Inner-animate: on" : "Inner-animate: off", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 40, 195, 35), m_circle.m_animate ? "Inner-animate: on" : "Inner-animate: off", 16))
 			m_circle.m_animate = !m_circle.m_animate;
 
 		// sides controls
-		scene.text(vertex_t(window::res_vec.m_x - m_bar, menu_y += 55,
+		scene.text(vertex_t(m_resolution.m_x - m_bar, menu_y += 55,
 			color_t{255, 255, 255, 255}), "Sides: " + std::to_string(m_circle.m_sides), 16);
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 25, 95, 35), "+", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 25, 95, 35), "+", 16))
 			if (m_circle.m_sides < 48) m_circle.m_sides++;
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar + 100, menu_y, 95, 35), "-", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar + 100, menu_y, 95, 35), "-", 16))
 			if (m_circle.m_sides > 3) m_circle.m_sides--;
 
 
 		// radius controls
-		scene.text(vertex_t(window::res_vec.m_x - m_bar, menu_y += 55,
+		scene.text(vertex_t(m_resolution.m_x - m_bar, menu_y += 55,
 			color_t{255, 255, 255, 255}), "Radius: " + std::to_string((std::int32_t)std::roundf(m_circle.m_radius)) + "px", 16);
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
 			if (m_circle.m_radius < 350.0f)
 				m_circle.m_radius += 100.0f * timer.get_delta();
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
 			if (m_circle.m_radius > 10.0f)
 				m_circle.m_radius -= 100.0f * timer.get_delta();
 
 		// line width controls
-		scene.text(vertex_t(window::res_vec.m_x - m_bar, menu_y += 55,
+		scene.text(vertex_t(m_resolution.m_x - m_bar, menu_y += 55,
 			color_t{255, 255, 255, 255}), "Outer width: " + std::to_string((std::int32_t)std::roundf(m_circle.m_width)) + "px", 16);
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
 			if (m_circle.m_width < 40.0f)
 				m_circle.m_width += 20.0f * timer.get_delta();
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
 			if (m_circle.m_width > 1.0f)
 				m_circle.m_width -= 20.0f * timer.get_delta();
 
 		// anim duration controls
-		scene.text(vertex_t(window::res_vec.m_x - m_bar, menu_y += 55,
+		scene.text(vertex_t(m_resolution.m_x - m_bar, menu_y += 55,
 			color_t{255, 255, 255, 255}), "Duration: " + std::to_string((std::int32_t)std::roundf(m_circle.m_anim_lenght)) + "s", 16);
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
 			if (m_circle.m_anim_lenght < 20.0f)
 				m_circle.m_anim_lenght += 10.0f * timer.get_delta();
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
 			if (m_circle.m_anim_lenght > 2.0f)
 				m_circle.m_anim_lenght -= 10.0f * timer.get_delta();		
 	}
 	
 	
 	
-	auto circle_center = point_t{window::center.m_x - m_bar / 2, window::center.m_y};
+	auto circle_center = point_t{m_center.m_x - m_bar / 2, m_center.m_y};
 
 	if (m_circle.m_outer)
 	{
-		scene.circle(vertex_t(circle_center.m_x, circle_center.m_y, color_t{255, 0, 80, 255}), m_circle.m_sides, m_circle.m_radius, m_circle.m_width);
+		scene.circle(vertex_t(circle_center.m_x, circle_center.m_y, color_t{255, 0, 80, 255}), m_circle.m_sides, m_circle.m_radius, m_circle.m_width, nullptr, edge_mode::feathered);
 	}
 	if (m_circle.m_inner)
 	{
@@ -215,7 +239,7 @@ auto demo_t::example_2(draw::scene_t& scene, timer_t& timer) -> void
 		}
 		else // render filled circle, not animated
 		{
-			scene.circle(vertex_t(circle_center.m_x, circle_center.m_y, color_t{255, 255, 255, 255}), m_circle.m_sides, m_circle.m_radius);
+			scene.circle(vertex_t(circle_center.m_x, circle_center.m_y, color_t{255, 255, 255, 255}), m_circle.m_sides, m_circle.m_radius, edge_mode::feathered);
 
 			if (m_circle.m_inner_lines)
 			{
@@ -233,48 +257,48 @@ auto demo_t::example_3(draw::scene_t& scene, timer_t& timer) -> void
 	// user interface
 	{
 		// render lines
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y, 195, 35), m_motion.m_lines ? "Lines: on" : "Lines: off", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y, 195, 35), m_motion.m_lines ? "Lines: on" : "Lines: off", 16))
 			m_motion.m_lines = !m_motion.m_lines;
 
 		// sides controls
-		scene.text(vertex_t(window::res_vec.m_x - m_bar, menu_y += 55,
+		scene.text(vertex_t(m_resolution.m_x - m_bar, menu_y += 55,
 			color_t{255, 255, 255, 255}), "Circles: " + std::to_string(m_motion.m_circles), 16);
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 25, 95, 35), "+", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 25, 95, 35), "+", 16))
 			if (m_motion.m_circles < 40) m_motion.m_circles++;
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar + 100, menu_y, 95, 35), "-", 16))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar + 100, menu_y, 95, 35), "-", 16))
 			if (m_motion.m_circles > 1) m_motion.m_circles--;
 
 
 		// radius controls
-		scene.text(vertex_t(window::res_vec.m_x - m_bar, menu_y += 55,
+		scene.text(vertex_t(m_resolution.m_x - m_bar, menu_y += 55,
 			color_t{255, 255, 255, 255}), "Radius: " + std::to_string((std::int32_t)std::roundf(m_motion.m_radius)) + "px", 16);
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
 			if (m_motion.m_radius < 350.0f)
 				m_motion.m_radius += 100.0f * timer.get_delta();
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
 			if (m_motion.m_radius > 50.0f)
 				m_motion.m_radius -= 100.0f * timer.get_delta();
 
 		// anim duration controls
-		scene.text(vertex_t(window::res_vec.m_x - m_bar, menu_y += 55,
+		scene.text(vertex_t(m_resolution.m_x - m_bar, menu_y += 55,
 			color_t{255, 255, 255, 255}), "Duration: " + std::to_string((std::int32_t)std::roundf(m_motion.m_anim_lenght)) + "s", 16);
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar, menu_y += 25, 95, 35), "+", 16, 1, 0))
 			if (m_motion.m_anim_lenght < 20.0f)
 				m_motion.m_anim_lenght += 10.0f * timer.get_delta();
 
-		if (scene.button(rect_t(window::res_vec.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
+		if (scene.button(rect_t(m_resolution.m_x - m_bar + 100, menu_y, 95, 35), "-", 16, 1, 0))
 			if (m_motion.m_anim_lenght > 2.0f)
 				m_motion.m_anim_lenght -= 10.0f * timer.get_delta();
 	}
 
 
 
-	auto center = point_t(window::center.m_x - m_bar / 2, window::center.m_y);
+	auto center = point_t(m_center.m_x - m_bar / 2, m_center.m_y);
 	auto offset = constants::pi / m_motion.m_circles;	
 
 	if (m_motion.m_alpha += 1 / m_motion.m_anim_lenght * timer.get_delta() * constants::pi * 2; m_motion.m_alpha > constants::pi * 2)
@@ -290,7 +314,7 @@ auto demo_t::example_3(draw::scene_t& scene, timer_t& timer) -> void
 			color_t{255, 0, 80, 255}
 		};
 	
-		scene.circle(circle_vert, 16, 7);
+		scene.circle(circle_vert, 7.0f);
 
 		if (m_motion.m_lines)
 		{
@@ -314,8 +338,17 @@ auto demo_t::example_3(draw::scene_t& scene, timer_t& timer) -> void
 
 auto demo_t::render(draw::scene_t& scene, timer_t& timer) -> void
 {
+	// the window can be resized, the layout follows it
+	m_resolution = scene.get_resolution();
+	m_center = point_t{m_resolution.m_x / 2, m_resolution.m_y / 2};
+
+	// the side bar is redrawn offscreen only when what it shows changes
 	if (m_ui_state != menu_state::main)
+	{
+		scene.begin_cached("menu");
 		this->draw_menu(scene, timer);
+		scene.end_cached();
+	}
 
 	switch (m_ui_state)
 	{
@@ -17,7 +17,12 @@ class demo_t
 	};
 
 	menu_state m_ui_state{menu_state::main};
+	point_t m_resolution{window::res_vec};
+	point_t m_center{window::res_vec.m_x / 2, window::res_vec.m_y / 2};
 	std::uint16_t m_bar{200};
+	present_mode m_present_mode{draw::settings::present::mode}; // requested, may differ from the active one
+	std::uint32_t m_frame_limit{0}; // index into settings::present::frame_limits
+	bool m_dynamic_resolution{draw::settings::resolution::dynamic};
 
 	// example 1 data
 	struct {
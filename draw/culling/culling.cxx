@@ -0,0 +1,220 @@
+#include "culling.hxx"
+
+#include "../utils/error.hxx"
+#include "../utils/settings.hxx"
+#include "../utils/init.hxx"
+
+draw::culling_t::culling_t(device_t* device, VkShaderModule shader, VkPipelineCache pipeline_cache, std::uint32_t frame_count)
+	: m_device{device}
+{
+	this->create_descriptors(frame_count);
+	this->create_pipeline(shader, pipeline_cache);
+
+	m_buffers.resize(frame_count);
+	for (auto i = std::uint32_t{0}; i < frame_count; i++)
+	{
+		this->create_buffer(i, settings::culling::min_size);
+		this->write_descriptor_set(i, nullptr);
+	}
+}
+
+draw::culling_t::~culling_t()
+{
+	for (auto i = std::uint32_t{0}; i < m_buffers.size(); i++)
+		this->destroy_buffer(i);
+
+	// pipeline
+	if (m_pipeline) ::vkDestroyPipeline(m_device->get_device(), m_pipeline, nullptr);
+	if (m_pipeline_layout) ::vkDestroyPipelineLayout(m_device->get_device(), m_pipeline_layout, nullptr);
+
+	// descriptor
+	if (m_descriptor.m_pool) ::vkDestroyDescriptorPool(m_device->get_device(), m_descriptor.m_pool, nullptr);
+	if (m_descriptor.m_set_layout) ::vkDestroyDescriptorSetLayout(m_device->get_device(), m_descriptor.m_set_layout, nullptr);
+}
+
+auto draw::culling_t::create_descriptors(std::uint32_t frame_count) -> void
+{
+	// 0: primitives in the ring buffer, 1: cull buffer
+	auto bindings = std::vector<VkDescriptorSetLayoutBinding>{
+		init::descriptor_set_layout_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT),
+		init::descriptor_set_layout_binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+	};
+
+	auto descriptor_set_layout_ci = init::descriptor_set_layout_create_info(bindings);
+	vk_check_result(::vkCreateDescriptorSetLayout(m_device->get_device(), &descriptor_set_layout_ci, nullptr, &m_descriptor.m_set_layout));
+
+	auto descriptor_pool_sizes = std::vector<VkDescriptorPoolSize>{init::descriptor_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)};
+	descriptor_pool_sizes.at(0).descriptorCount = static_cast<std::uint32_t>(bindings.size()) * frame_count;
+
+	auto descriptor_pool_ci = init::descriptor_pool_create_info(descriptor_pool_sizes);
+	descriptor_pool_ci.maxSets = frame_count;
+	vk_check_result(::vkCreateDescriptorPool(m_device->get_device(), &descriptor_pool_ci, nullptr, &m_descriptor.m_pool));
+
+	m_descriptor.m_sets.resize(frame_count);
+	m_descriptor.m_inputs.resize(frame_count);
+	for (auto& set : m_descriptor.m_sets)
+	{
+		auto descriptor_set_ai = init::descriptor_set_allocate_info(m_descriptor.m_pool, m_descriptor.m_set_layout);
+		vk_check_result(::vkAllocateDescriptorSets(m_device->get_device(), &descriptor_set_ai, &set));
+	}
+
+	auto push_constant_ranges = std::vector<VkPushConstantRange>{
+		VkPushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(cull_constants_t)}
+	};
+
+	auto pipeline_layout_ci = init::pipeline_layout_create_info(m_descriptor.m_set_layout, push_constant_ranges);
+	vk_check_result(::vkCreatePipelineLayout(m_device->get_device(), &pipeline_layout_ci, nullptr, &m_pipeline_layout));
+}
+
+auto draw::culling_t::create_pipeline(VkShaderModule shader, VkPipelineCache pipeline_cache) -> void
+{
+	auto pipeline_ci = init::compute_pipeline_create_info(shader, settings::shaders::entry_point, m_pipeline_layout);
+	vk_check_result(::vkCreateComputePipelines(m_device->get_device(), pipeline_cache, 1, &pipeline_ci, nullptr, &m_pipeline));
+}
+
+auto draw::culling_t::create_buffer(std::uint32_t frame_index, VkDeviceSize size) -> void
+{
+	auto& buffer = m_buffers.at(frame_index);
+	buffer.m_size = size;
+
+	auto buffer_ci = init::buffer_create_info(size, settings::culling::usage);
+	vk_check_result(::vkCreateBuffer(m_device->get_device(), &buffer_ci, nullptr, &buffer.m_buffer));
+
+	buffer.m_allocation = m_device->allocate_buffer_memory(buffer.m_buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+auto draw::culling_t::destroy_buffer(std::uint32_t frame_index) -> void
+{
+	auto& buffer = m_buffers.at(frame_index);
+
+	if (buffer.m_buffer) ::vkDestroyBuffer(m_device->get_device(), buffer.m_buffer, nullptr);
+	if (buffer.m_allocation.m_memory) m_device->free_memory(buffer.m_allocation);
+
+	buffer = memory_buffer_t{};
+}
+
+auto draw::culling_t::write_descriptor_set(std::uint32_t frame_index, VkBuffer input) -> void
+{
+	m_descriptor.m_inputs.at(frame_index) = input;
+
+	auto input_bi = VkDescriptorBufferInfo{input, 0, VK_WHOLE_SIZE};
+	auto output_bi = VkDescriptorBufferInfo{m_buffers.at(frame_index).m_buffer, 0, VK_WHOLE_SIZE};
+
+	auto write_descriptor_sets = std::vector<VkWriteDescriptorSet>{
+		init::write_descriptor_set(m_descriptor.m_sets.at(frame_index), 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, output_bi)
+	};
+
+	// the ring buffer isn't known until the first frame
+	if (input)
+		write_descriptor_sets.push_back(init::write_descriptor_set(m_descriptor.m_sets.at(frame_index), 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, input_bi));
+
+	::vkUpdateDescriptorSets(m_device->get_device(), static_cast<std::uint32_t>(write_descriptor_sets.size()), write_descriptor_sets.data(), 0, nullptr);
+}
+
+auto draw::culling_t::begin_frame(std::uint32_t frame_index) -> void
+{
+	m_frame_index = frame_index % m_buffers.size();
+	m_streams.clear();
+	m_head = 0;
+}
+
+auto draw::culling_t::add_stream(cull_kind kind, VkDeviceSize input_offset, std::uint32_t count, std::uint32_t stride, const std::array<std::float_t, 4>& clip) -> std::uint32_t
+{
+	auto groups = (count + settings::culling::group_size - 1) / settings::culling::group_size;
+
+	// meshes come out as draw commands, every other kind as compacted instances
+	auto output_stride = kind == cull_kind::mesh ? VkDeviceSize{sizeof(VkDrawIndexedIndirectCommand)} : VkDeviceSize{stride};
+
+	// indirect command slot, then the survivors, then the per workgroup counts
+	auto stream = cull_stream_t{};
+	stream.m_kind = kind;
+	stream.m_clip = clip;
+	stream.m_count = count;
+	stream.m_stride = stride;
+	stream.m_input_offset = input_offset;
+	stream.m_command_offset = (m_head + 15) & ~VkDeviceSize{15};
+	stream.m_output_offset = stream.m_command_offset + settings::culling::command_size;
+	stream.m_scratch_offset = stream.m_output_offset + output_stride * count;
+
+	m_head = stream.m_scratch_offset + sizeof(std::uint32_t) * groups;
+	m_streams.push_back(stream);
+
+	return static_cast<std::uint32_t>(m_streams.size() - 1);
+}
+
+auto draw::culling_t::dispatch(VkCommandBuffer command_buffer, VkBuffer input, const push_constants_t& projection) -> void
+{
+	if (m_streams.empty())
+		return;
+
+	// the gpu is done with this frame's buffer, it can be replaced without waiting
+	if (m_head > m_buffers.at(m_frame_index).m_size)
+	{
+		auto size = static_cast<VkDeviceSize>(m_buffers.at(m_frame_index).m_size) * 2;
+		for (; size < m_head; ) size *= 2;
+
+		this->destroy_buffer(m_frame_index);
+		this->create_buffer(m_frame_index, size);
+		this->write_descriptor_set(m_frame_index, input);
+	}
+	else if (m_descriptor.m_inputs.at(m_frame_index) != input) // the ring buffer was reallocated
+		this->write_descriptor_set(m_frame_index, input);
+
+	::vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+	::vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &m_descriptor.m_sets.at(m_frame_index), 0, nullptr);
+
+	// count visible primitives per workgroup, scan the counts, then compact in submission order
+	for (auto pass = std::uint32_t{0}; pass < 3; pass++)
+	{
+		for (const auto& stream : m_streams)
+		{
+			auto constants = cull_constants_t{
+				projection,
+				stream.m_clip,
+				settings::font::glyph_box,
+				stream.m_kind,
+				stream.m_count,
+				stream.m_stride / 4,
+				static_cast<std::uint32_t>(stream.m_input_offset / 4),
+				static_cast<std::uint32_t>(stream.m_output_offset / 4),
+				static_cast<std::uint32_t>(stream.m_scratch_offset / 4),
+				static_cast<std::uint32_t>(stream.m_command_offset / 4),
+				pass
+			};
+
+			auto groups = (stream.m_count + settings::culling::group_size - 1) / settings::culling::group_size;
+
+			::vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(cull_constants_t), &constants);
+			::vkCmdDispatch(command_buffer, pass == 1 ? 1 : groups, 1, 1);
+		}
+
+		auto last = pass == 2;
+		auto memory_b = init::memory_barrier(
+			VK_ACCESS_SHADER_WRITE_BIT,
+			last ? VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT : VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+		);
+
+		::vkCmdPipelineBarrier(
+			command_buffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			last ? VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			std::uint32_t{0},
+			std::uint32_t{1},
+			&memory_b,
+			std::uint32_t{0},
+			nullptr,
+			std::uint32_t{0},
+			nullptr
+		);
+	}
+}
+
+auto draw::culling_t::get_stream(std::uint32_t index) -> const cull_stream_t&
+{
+	return m_streams.at(index);
+}
+
+auto draw::culling_t::get_buffer() -> const VkBuffer&
+{
+	return m_buffers.at(m_frame_index).m_buffer;
+}
\ No newline at end of file
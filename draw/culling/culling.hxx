@@ -0,0 +1,70 @@
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+
+#include <array>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "../device/device.hxx"
+#include "../utils/containers.hxx"
+
+namespace draw
+{
+	// compute pass culling primitive streams against their clip rect, survivors are compacted
+	// in order and consumed through indirect draws
+	class culling_t
+	{
+		device_t* m_device{nullptr};
+
+		// descriptor
+		struct {
+			VkDescriptorSetLayout m_set_layout{nullptr};
+			VkDescriptorPool m_pool{nullptr};
+			std::vector<VkDescriptorSet> m_sets{}; // one per frame in flight
+			std::vector<VkBuffer> m_inputs{}; // ring buffer each set currently reads from
+		} m_descriptor{};
+
+		// pipeline
+		VkPipelineLayout m_pipeline_layout{nullptr};
+		VkPipeline m_pipeline{nullptr};
+
+		// outputs, one buffer per frame in flight
+		std::vector<memory_buffer_t> m_buffers{};
+
+		std::uint32_t m_frame_index{0};
+		VkDeviceSize m_head{0}; // bytes laid out for the current frame
+		std::vector<cull_stream_t> m_streams{}; // one per culled draw of the frame
+
+	public:
+
+		culling_t(device_t* device, VkShaderModule shader, VkPipelineCache pipeline_cache, std::uint32_t frame_count);
+
+		~culling_t();
+
+	private:
+
+		auto create_descriptors(std::uint32_t frame_count) -> void;
+
+		auto create_pipeline(VkShaderModule shader, VkPipelineCache pipeline_cache) -> void;
+
+		auto create_buffer(std::uint32_t frame_index, VkDeviceSize size) -> void;
+
+		auto destroy_buffer(std::uint32_t frame_index) -> void;
+
+		auto write_descriptor_set(std::uint32_t frame_index, VkBuffer input) -> void;
+
+	public:
+
+		auto begin_frame(std::uint32_t frame_index) -> void;
+
+		auto add_stream(cull_kind kind, VkDeviceSize input_offset, std::uint32_t count, std::uint32_t stride, const std::array<std::float_t, 4>& clip) -> std::uint32_t;
+
+		auto dispatch(VkCommandBuffer command_buffer, VkBuffer input, const push_constants_t& projection) -> void;
+
+		auto get_stream(std::uint32_t index) -> const cull_stream_t&;
+
+		auto get_buffer() -> const VkBuffer&;
+	};
+}
\ No newline at end of file
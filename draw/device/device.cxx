@@ -1,5 +1,8 @@
 #include "device.hxx"
 
+#include <algorithm>
+#include <cstring>
+
 #include "../utils/settings.hxx"
 #include "../utils/init.hxx"
 #include "../utils/error.hxx"
@@ -16,6 +19,9 @@ draw::device_t::device_t()
 
 draw::device_t::~device_t()
 {
+	for (auto& block : m_blocks)
+		if (block.m_memory) ::vkFreeMemory(m_logical_device, block.m_memory, nullptr);
+
 	if (m_logical_device) ::vkDestroyDevice(m_logical_device, nullptr);
 	if (m_instance) ::vkDestroyInstance(m_instance, nullptr);
 }
@@ -42,10 +48,38 @@ auto draw::device_t::pick_physical_device() -> void
 auto draw::device_t::find_device_specs() -> void
 {
 	::vkGetPhysicalDeviceFeatures(m_physical_device, &m_physical_device_features);
+
+	// present pacing, optional
+	auto present_wait_features = VkPhysicalDevicePresentWaitFeaturesKHR{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+	auto present_id_features = VkPhysicalDevicePresentIdFeaturesKHR{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR, &present_wait_features};
+
+	m_vulkan_12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	m_vulkan_12_features.pNext = &present_id_features;
+	auto features = VkPhysicalDeviceFeatures2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &m_vulkan_12_features};
+	::vkGetPhysicalDeviceFeatures2(m_physical_device, &features);
+	m_vulkan_12_features.pNext = nullptr;
+
+	m_present_wait = this->supports_extension(VK_KHR_PRESENT_ID_EXTENSION_NAME) && this->supports_extension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) &&
+		present_id_features.presentId && present_wait_features.presentWait;
+
+	// damage rects are only a hint, presenting works the same without them
+	m_incremental_present = this->supports_extension(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+
 	::vkGetPhysicalDeviceProperties(m_physical_device, &m_physical_device_properties);
 	::vkGetPhysicalDeviceMemoryProperties(m_physical_device, &m_memory_properties);
 }
 
+auto draw::device_t::supports_extension(const char* name) -> bool
+{
+	auto extension_count = std::uint32_t{0};
+	vk_check_result(::vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &extension_count, nullptr));
+
+	auto extensions = std::vector<VkExtensionProperties>{ extension_count };
+	vk_check_result(::vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &extension_count, extensions.data()));
+
+	return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& extension) { return !std::strcmp(extension.extensionName, name); });
+}
+
 auto draw::device_t::find_queue_specs() -> void
 {
 	auto queue_family_count = std::uint32_t{ 0 };
@@ -54,47 +88,44 @@ auto draw::device_t::find_queue_specs() -> void
 	::vkGetPhysicalDeviceQueueFamilyProperties(m_physical_device, &queue_family_count, m_queue_family_properties.data());
 }
 
-auto draw::device_t::queue_family_index(std::uint32_t queue_flag) -> std::uint32_t
+auto draw::device_t::queue_family_index(VkQueueFlags required, VkQueueFlags excluded) -> std::uint32_t
 {
 	for (const auto& queue_family : m_queue_family_properties)
-		if ((queue_flag ^ queue_family.queueFlags) == 0) // has to match every flag
-			return &queue_family - &m_queue_family_properties.at(0); // return index
+		if ((queue_family.queueFlags & required) == required && !(queue_family.queueFlags & excluded))
+			return static_cast<std::uint32_t>(&queue_family - &m_queue_family_properties.at(0)); // return index
+
+	return ~0u;
 }
 
 auto draw::device_t::get_queue_create_infos() -> std::vector<VkDeviceQueueCreateInfo>
 {
-	// assign queue family ids
-	m_queue_family_indices.m_graphics = this->queue_family_index(
-		VK_QUEUE_GRAPHICS_BIT |
-		VK_QUEUE_COMPUTE_BIT |
-		VK_QUEUE_TRANSFER_BIT |
-		VK_QUEUE_SPARSE_BINDING_BIT);
-
-	m_queue_family_indices.m_compute = this->queue_family_index(
-		VK_QUEUE_COMPUTE_BIT |
-		VK_QUEUE_TRANSFER_BIT |
-		VK_QUEUE_SPARSE_BINDING_BIT);
+	// assign queue family ids, graphics families implicitly support transfers
+	m_queue_family_indices.m_graphics = this->queue_family_index(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, 0);
 
-	m_queue_family_indices.m_transfer = this->queue_family_index(
-		VK_QUEUE_TRANSFER_BIT |
-		VK_QUEUE_SPARSE_BINDING_BIT);
+	// prefer families of their own, copy engines run next to the graphics queue
+	m_queue_family_indices.m_compute = this->queue_family_index(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+	if (m_queue_family_indices.m_compute == ~0u)
+		m_queue_family_indices.m_compute = m_queue_family_indices.m_graphics;
 
-	auto create_infos = std::vector<VkDeviceQueueCreateInfo>{ 3 };
+	m_queue_family_indices.m_transfer = this->queue_family_index(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+	if (m_queue_family_indices.m_transfer == ~0u)
+		m_queue_family_indices.m_transfer = m_queue_family_indices.m_compute;
 
-	create_infos.at(0).sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	create_infos.at(0).queueFamilyIndex = m_queue_family_indices.m_graphics;
-	create_infos.at(0).queueCount = std::uint32_t{ 1 };
-	create_infos.at(0).pQueuePriorities = &settings::queue_priority;
+	// one create info per distinct family
+	auto create_infos = std::vector<VkDeviceQueueCreateInfo>{ };
 
-	create_infos.at(1).sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	create_infos.at(1).queueFamilyIndex = m_queue_family_indices.m_compute;
-	create_infos.at(1).queueCount = std::uint32_t{ 1 };
-	create_infos.at(1).pQueuePriorities = &settings::queue_priority;
+	for (auto family : {m_queue_family_indices.m_graphics, m_queue_family_indices.m_compute, m_queue_family_indices.m_transfer})
+	{
+		if (std::any_of(create_infos.begin(), create_infos.end(), [family](const VkDeviceQueueCreateInfo& ci) { return ci.queueFamilyIndex == family; }))
+			continue;
 
-	create_infos.at(2).sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	create_infos.at(2).queueFamilyIndex = m_queue_family_indices.m_transfer;
-	create_infos.at(2).queueCount = std::uint32_t{ 1 };
-	create_infos.at(2).pQueuePriorities = &settings::queue_priority;
+		auto create_info = VkDeviceQueueCreateInfo{ };
+		create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		create_info.queueFamilyIndex = family;
+		create_info.queueCount = std::uint32_t{ 1 };
+		create_info.pQueuePriorities = &settings::queue_priority;
+		create_infos.push_back(create_info);
+	}
 
 	return create_infos;
 }
@@ -102,13 +133,36 @@ auto draw::device_t::get_queue_create_infos() -> std::vector<VkDeviceQueueCreate
 auto draw::device_t::create_logical_device() -> void
 {
 	auto create_infos = this->get_queue_create_infos();
-	auto device_ci = init::device_create_info(create_infos, settings::device_extensions);
+
+	// only what the renderer makes use of, when available
+	auto vulkan_12_features = VkPhysicalDeviceVulkan12Features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+	vulkan_12_features.drawIndirectCount = m_vulkan_12_features.drawIndirectCount;
+	vulkan_12_features.timelineSemaphore = VK_TRUE; // core in 1.2, signals finished uploads
+
+	auto device_extensions = settings::device_extensions;
+	auto present_wait_features = VkPhysicalDevicePresentWaitFeaturesKHR{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR, nullptr, VK_TRUE};
+	auto present_id_features = VkPhysicalDevicePresentIdFeaturesKHR{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR, &present_wait_features, VK_TRUE};
+
+	if (m_present_wait)
+	{
+		device_extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		device_extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		vulkan_12_features.pNext = &present_id_features;
+	}
+
+	if (m_incremental_present)
+		device_extensions.push_back(VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+
+	auto enabled_features = VkPhysicalDeviceFeatures2{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, &vulkan_12_features};
+
+	auto device_ci = init::device_create_info(create_infos, device_extensions, &enabled_features);
 	vk_check_result(::vkCreateDevice(m_physical_device, &device_ci, nullptr, &m_logical_device))
 }
 
 auto draw::device_t::retrieve_device_queues() -> void
 {
 	::vkGetDeviceQueue(m_logical_device, m_queue_family_indices.m_graphics, 0, &m_graphics_queue);
+	::vkGetDeviceQueue(m_logical_device, m_queue_family_indices.m_transfer, 0, &m_transfer_queue);
 }
 
 auto draw::device_t::get_instance() -> const VkInstance
@@ -116,6 +170,11 @@ auto draw::device_t::get_instance() -> const VkInstance
 	return m_instance;
 }
 
+auto draw::device_t::get_physical_device() -> const VkPhysicalDevice
+{
+	return m_physical_device;
+}
+
 auto draw::device_t::get_device() -> const VkDevice
 {
 	return m_logical_device;
@@ -131,6 +190,36 @@ auto draw::device_t::get_graphics_queue_index() -> std::uint32_t
 	return m_queue_family_indices.m_graphics;
 }
 
+auto draw::device_t::get_transfer_queue() -> const VkQueue
+{
+	return m_transfer_queue;
+}
+
+auto draw::device_t::get_transfer_queue_index() -> std::uint32_t
+{
+	return m_queue_family_indices.m_transfer;
+}
+
+auto draw::device_t::get_vulkan_12_features() -> const VkPhysicalDeviceVulkan12Features&
+{
+	return m_vulkan_12_features;
+}
+
+auto draw::device_t::get_physical_device_properties() -> const VkPhysicalDeviceProperties&
+{
+	return m_physical_device_properties;
+}
+
+auto draw::device_t::get_present_wait() -> bool
+{
+	return m_present_wait;
+}
+
+auto draw::device_t::get_incremental_present() -> bool
+{
+	return m_incremental_present;
+}
+
 auto draw::device_t::get_memory_type_index(std::uint32_t type_bits, VkMemoryPropertyFlags property_flags) -> std::uint32_t
 {
 	for (auto i = std::uint32_t{ 0 }; i < m_memory_properties.memoryTypeCount; i++)
@@ -141,4 +230,225 @@ auto draw::device_t::get_memory_type_index(std::uint32_t type_bits, VkMemoryProp
 
 		type_bits >>= 1;
 	}
+}
+
+auto draw::device_t::create_memory_block(std::uint32_t type, VkDeviceSize size, memory_strategy strategy, bool optimal) -> std::uint32_t
+{
+	auto block = memory_block_t{nullptr, size, nullptr, type, strategy, optimal};
+	if (strategy == memory_strategy::free_list)
+		block.m_free.push_back(memory_range_t{0, size});
+
+	auto memory_ai = init::memory_allocate_info();
+	memory_ai.allocationSize = size;
+	memory_ai.memoryTypeIndex = type;
+	vk_check_result(::vkAllocateMemory(m_logical_device, &memory_ai, nullptr, &block.m_memory));
+
+	// mapped once for the lifetime of the block, allocations point into it
+	if (m_memory_properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void* data{nullptr};
+		vk_check_result(::vkMapMemory(m_logical_device, block.m_memory, 0, size, 0, &data));
+		block.m_mapped = static_cast<std::uint8_t*>(data);
+	}
+
+	m_blocks.push_back(std::move(block));
+	return static_cast<std::uint32_t>(m_blocks.size() - 1);
+}
+
+auto draw::device_t::sub_allocate(memory_block_t& block, VkDeviceSize size, VkDeviceSize alignment) -> VkDeviceSize
+{
+	auto align = [alignment](VkDeviceSize offset) { return (offset + alignment - 1) / alignment * alignment; };
+
+	if (block.m_strategy == memory_strategy::linear)
+	{
+		auto offset = align(block.m_head);
+		if (offset + size > block.m_size)
+			return VK_WHOLE_SIZE;
+
+		block.m_head = offset + size;
+		block.m_used += size;
+		block.m_allocations++;
+		return offset;
+	}
+
+	// first fit, padding in front of an aligned offset stays in the free list
+	for (auto i = std::size_t{0}; i < block.m_free.size(); i++)
+	{
+		auto range = block.m_free.at(i);
+		auto offset = align(range.m_offset);
+		if (offset + size > range.m_offset + range.m_size)
+			continue;
+
+		auto front = memory_range_t{range.m_offset, offset - range.m_offset};
+		auto back = memory_range_t{offset + size, range.m_offset + range.m_size - offset - size};
+
+		block.m_free.erase(block.m_free.begin() + i);
+		if (back.m_size) block.m_free.insert(block.m_free.begin() + i, back);
+		if (front.m_size) block.m_free.insert(block.m_free.begin() + i, front);
+
+		block.m_used += size;
+		block.m_allocations++;
+		return offset;
+	}
+
+	return VK_WHOLE_SIZE;
+}
+
+auto draw::device_t::allocate_dedicated(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags property_flags, VkImage image) -> memory_allocation_t
+{
+	auto type = this->get_memory_type_index(requirements.memoryTypeBits, property_flags);
+	auto allocation = memory_allocation_t{nullptr, 0, requirements.size, nullptr, ~0u};
+
+	auto dedicated_ai = VkMemoryDedicatedAllocateInfo{VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO, nullptr, image, nullptr};
+	auto memory_ai = init::memory_allocate_info();
+	memory_ai.pNext = &dedicated_ai;
+	memory_ai.allocationSize = requirements.size;
+	memory_ai.memoryTypeIndex = type;
+	vk_check_result(::vkAllocateMemory(m_logical_device, &memory_ai, nullptr, &allocation.m_memory));
+
+	if (m_memory_properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		vk_check_result(::vkMapMemory(m_logical_device, allocation.m_memory, 0, requirements.size, 0, &allocation.m_mapped));
+
+	auto lock = std::lock_guard{m_memory_mutex};
+	m_dedicated.m_size += requirements.size;
+	m_dedicated.m_count++;
+
+	return allocation;
+}
+
+auto draw::device_t::allocate_memory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags property_flags, bool optimal, memory_strategy strategy) -> memory_allocation_t
+{
+	auto type = this->get_memory_type_index(requirements.memoryTypeBits, property_flags);
+
+	// buffers and images never share a block when a granularity page could hold both
+	optimal = optimal && m_physical_device_properties.limits.bufferImageGranularity > 1;
+
+	auto lock = std::lock_guard{m_memory_mutex};
+
+	auto allocation = [&](std::uint32_t index, VkDeviceSize offset) {
+		const auto& block = m_blocks.at(index);
+		return memory_allocation_t{block.m_memory, offset, requirements.size, block.m_mapped ? block.m_mapped + offset : nullptr, index};
+	};
+
+	for (auto i = std::uint32_t{0}; i < m_blocks.size(); i++)
+	{
+		auto& block = m_blocks.at(i);
+		if (block.m_type != type || block.m_strategy != strategy || block.m_optimal != optimal)
+			continue;
+
+		if (auto offset = this->sub_allocate(block, requirements.size, requirements.alignment); offset != VK_WHOLE_SIZE)
+			return allocation(i, offset);
+	}
+
+	auto block_size = strategy == memory_strategy::linear ? settings::memory::linear_block_size : settings::memory::block_size;
+	auto index = this->create_memory_block(type, std::max(block_size, requirements.size), strategy, optimal);
+
+	return allocation(index, this->sub_allocate(m_blocks.at(index), requirements.size, requirements.alignment));
+}
+
+auto draw::device_t::allocate_buffer_memory(VkBuffer buffer, VkMemoryPropertyFlags property_flags, memory_strategy strategy) -> memory_allocation_t
+{
+	auto memory_reqs = init::memory_requirements();
+	::vkGetBufferMemoryRequirements(m_logical_device, buffer, &memory_reqs);
+
+	auto allocation = this->allocate_memory(memory_reqs, property_flags, false, strategy);
+	vk_check_result(::vkBindBufferMemory(m_logical_device, buffer, allocation.m_memory, allocation.m_offset));
+
+	return allocation;
+}
+
+auto draw::device_t::allocate_image_memory(VkImage image, VkMemoryPropertyFlags property_flags) -> memory_allocation_t
+{
+	auto dedicated_reqs = VkMemoryDedicatedRequirements{VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS};
+	auto memory_reqs = VkMemoryRequirements2{VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2, &dedicated_reqs};
+	auto memory_ri = VkImageMemoryRequirementsInfo2{VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2, nullptr, image};
+	::vkGetImageMemoryRequirements2(m_logical_device, &memory_ri, &memory_reqs);
+
+	const auto& requirements = memory_reqs.memoryRequirements;
+	auto dedicated = dedicated_reqs.prefersDedicatedAllocation || dedicated_reqs.requiresDedicatedAllocation || requirements.size >= settings::memory::dedicated_size;
+
+	auto allocation = dedicated ? this->allocate_dedicated(requirements, property_flags, image) : this->allocate_memory(requirements, property_flags, true);
+	vk_check_result(::vkBindImageMemory(m_logical_device, image, allocation.m_memory, allocation.m_offset));
+
+	return allocation;
+}
+
+auto draw::device_t::free_memory(memory_allocation_t& allocation) -> void
+{
+	auto lock = std::lock_guard{m_memory_mutex};
+
+	if (allocation.m_block == ~0u)
+	{
+		::vkFreeMemory(m_logical_device, allocation.m_memory, nullptr);
+		m_dedicated.m_size -= allocation.m_size;
+		m_dedicated.m_count--;
+
+		allocation = memory_allocation_t{};
+		return;
+	}
+
+	// blocks stay allocated, their space is reused
+	auto& block = m_blocks.at(allocation.m_block);
+	block.m_used -= allocation.m_size;
+	block.m_allocations--;
+
+	if (block.m_strategy == memory_strategy::linear)
+	{
+		if (!block.m_allocations) block.m_head = 0;
+	}
+	else
+	{
+		auto range = memory_range_t{allocation.m_offset, allocation.m_size};
+		auto next = std::lower_bound(block.m_free.begin(), block.m_free.end(), range.m_offset, [](const memory_range_t& r, VkDeviceSize offset) { return r.m_offset < offset; });
+
+		// merge with the neighbours on either side
+		if (next != block.m_free.end() && range.m_offset + range.m_size == next->m_offset)
+		{
+			range.m_size += next->m_size;
+			next = block.m_free.erase(next);
+		}
+		if (next != block.m_free.begin() && std::prev(next)->m_offset + std::prev(next)->m_size == range.m_offset)
+			std::prev(next)->m_size += range.m_size;
+		else
+			block.m_free.insert(next, range);
+	}
+
+	allocation = memory_allocation_t{};
+}
+
+auto draw::device_t::get_memory_stats() -> memory_stats_t
+{
+	auto lock = std::lock_guard{m_memory_mutex};
+
+	auto stats = memory_stats_t{m_dedicated.m_size, m_dedicated.m_size, m_dedicated.m_count};
+	auto free_size = VkDeviceSize{0};
+	auto largest_size = VkDeviceSize{0}; // sum of the largest free range of each block
+
+	for (const auto& block : m_blocks)
+	{
+		stats.m_used += block.m_used;
+		stats.m_reserved += block.m_size;
+		stats.m_allocations++;
+
+		if (block.m_strategy == memory_strategy::linear)
+		{
+			// freed space only returns once the block is empty
+			free_size += block.m_size - block.m_used;
+			largest_size += block.m_size - block.m_head;
+			continue;
+		}
+
+		auto largest = VkDeviceSize{0};
+		for (const auto& range : block.m_free)
+		{
+			free_size += range.m_size;
+			largest = std::max(largest, range.m_size);
+		}
+		largest_size += largest;
+	}
+
+	if (free_size)
+		stats.m_fragmentation = 1.0f - static_cast<std::float_t>(largest_size) / static_cast<std::float_t>(free_size);
+
+	return stats;
 }
\ No newline at end of file
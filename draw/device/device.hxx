@@ -3,9 +3,12 @@
 #define VK_USE_PLATFORM_WIN32_KHR
 
 #include <cstdint>
+#include <mutex>
 #include <vector>
 #include <vulkan/vulkan.h>
 
+#include "../utils/containers.hxx"
+
 namespace draw
 {
 	class device_t
@@ -15,11 +18,15 @@ namespace draw
 		VkDevice m_logical_device{ nullptr };
 
 		VkPhysicalDeviceFeatures m_physical_device_features{ };
+		VkPhysicalDeviceVulkan12Features m_vulkan_12_features{ };
+		bool m_present_wait{ false }; // VK_KHR_present_id and VK_KHR_present_wait, both supported and enabled
+		bool m_incremental_present{ false }; // VK_KHR_incremental_present supported and enabled
 		VkPhysicalDeviceProperties m_physical_device_properties{ };
 		VkPhysicalDeviceMemoryProperties m_memory_properties{ };
 
 		std::vector<VkQueueFamilyProperties> m_queue_family_properties{ };
 		VkQueue m_graphics_queue{ nullptr };
+		VkQueue m_transfer_queue{ nullptr };
 
 		struct {
 			std::uint32_t m_graphics{};
@@ -27,6 +34,15 @@ namespace draw
 			std::uint32_t m_transfer{};
 		} m_queue_family_indices;
 
+		// sub-allocated device memory, resources are created from several threads during startup
+		std::mutex m_memory_mutex{ };
+		std::vector<memory_block_t> m_blocks{ };
+
+		struct {
+			VkDeviceSize m_size{};
+			std::uint32_t m_count{};
+		} m_dedicated{ };
+
 	public:
 
 		device_t();
@@ -41,9 +57,11 @@ namespace draw
 
 		auto find_device_specs() -> void;
 
+		auto supports_extension(const char* name) -> bool;
+
 		auto find_queue_specs() -> void;
 
-		auto queue_family_index(std::uint32_t queue_flag) -> std::uint32_t;
+		auto queue_family_index(VkQueueFlags required, VkQueueFlags excluded) -> std::uint32_t;
 
 		auto get_queue_create_infos() -> std::vector<VkDeviceQueueCreateInfo>;
 
@@ -51,16 +69,49 @@ namespace draw
 
 		auto retrieve_device_queues() -> void;
 
+		auto create_memory_block(std::uint32_t type, VkDeviceSize size, memory_strategy strategy, bool optimal) -> std::uint32_t;
+
+		auto sub_allocate(memory_block_t& block, VkDeviceSize size, VkDeviceSize alignment) -> VkDeviceSize;
+
+		auto allocate_dedicated(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags property_flags, VkImage image) -> memory_allocation_t;
+
 	public:
 
 		auto get_instance() -> const VkInstance;
 
+		auto get_physical_device() -> const VkPhysicalDevice;
+
 		auto get_device() -> const VkDevice;
 
 		auto get_graphics_queue() -> const VkQueue;
 
 		auto get_graphics_queue_index() -> std::uint32_t;
 
+		auto get_transfer_queue() -> const VkQueue;
+
+		auto get_transfer_queue_index() -> std::uint32_t;
+
+		auto get_vulkan_12_features() -> const VkPhysicalDeviceVulkan12Features&;
+
+		auto get_physical_device_properties() -> const VkPhysicalDeviceProperties&;
+
+		auto get_present_wait() -> bool;
+
+		auto get_incremental_present() -> bool;
+
 		auto get_memory_type_index(std::uint32_t type_bits, VkMemoryPropertyFlags property_flags) -> std::uint32_t;
+
+		// optimal for images, buffers are linear resources
+		auto allocate_memory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags property_flags, bool optimal, memory_strategy strategy = memory_strategy::free_list) -> memory_allocation_t;
+
+		// allocates and binds
+		auto allocate_buffer_memory(VkBuffer buffer, VkMemoryPropertyFlags property_flags, memory_strategy strategy = memory_strategy::free_list) -> memory_allocation_t;
+
+		// allocates and binds, large images get a dedicated allocation
+		auto allocate_image_memory(VkImage image, VkMemoryPropertyFlags property_flags) -> memory_allocation_t;
+
+		auto free_memory(memory_allocation_t& allocation) -> void;
+
+		auto get_memory_stats() -> memory_stats_t;
 	};
 }
@@ -0,0 +1,135 @@
+#include "layer_cache.hxx"
+
+#include "../utils/error.hxx"
+#include "../utils/settings.hxx"
+#include "../utils/init.hxx"
+
+draw::layer_cache_t::layer_cache_t(device_t* device, VkImageView depth_view, VkExtent2D extent)
+	: m_device{device},
+	m_depth_view{depth_view},
+	m_extent{extent}
+{
+	this->create_render_pass();
+	this->create_descriptors();
+
+	// the layer matches the target pixel for pixel, composite.frag fetches texels directly
+	auto sampler_ci = init::sampler_create_info(VK_FILTER_NEAREST);
+	vk_check_result(::vkCreateSampler(m_device->get_device(), &sampler_ci, nullptr, &m_sampler));
+}
+
+draw::layer_cache_t::~layer_cache_t()
+{
+	for (auto& layer : m_layers)
+		this->destroy_target(layer);
+
+	if (m_sampler) ::vkDestroySampler(m_device->get_device(), m_sampler, nullptr);
+
+	// descriptor
+	if (m_descriptor.m_pool) ::vkDestroyDescriptorPool(m_device->get_device(), m_descriptor.m_pool, nullptr);
+	if (m_descriptor.m_set_layout) ::vkDestroyDescriptorSetLayout(m_device->get_device(), m_descriptor.m_set_layout, nullptr);
+
+	if (m_render_pass) ::vkDestroyRenderPass(m_device->get_device(), m_render_pass, nullptr);
+}
+
+auto draw::layer_cache_t::create_render_pass() -> void
+{
+	auto color_attachment_ref = VkAttachmentReference{std::uint32_t{0}, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+	auto depth_attachment_ref = VkAttachmentReference{std::uint32_t{1}, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+	// same attachments as the swap chain pass so its pipelines can be used, left ready to be sampled
+	auto attachments = init::attachment_descriptions(settings::color_format, settings::depth_format, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	auto subpass = init::subpass_description(color_attachment_ref, depth_attachment_ref);
+	auto dependencies = init::subpass_dependencies(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+	auto render_pass_ci = init::render_pass_create_info(attachments, subpass, dependencies);
+	vk_check_result(::vkCreateRenderPass(m_device->get_device(), &render_pass_ci, nullptr, &m_render_pass));
+}
+
+auto draw::layer_cache_t::create_descriptors() -> void
+{
+	// 0: the layer image, laid out like the composite pipeline's own set
+	auto bindings = std::vector<VkDescriptorSetLayoutBinding>{
+		init::descriptor_set_layout_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+	};
+
+	auto descriptor_set_layout_ci = init::descriptor_set_layout_create_info(bindings);
+	vk_check_result(::vkCreateDescriptorSetLayout(m_device->get_device(), &descriptor_set_layout_ci, nullptr, &m_descriptor.m_set_layout));
+
+	auto descriptor_pool_sizes = std::vector<VkDescriptorPoolSize>{init::descriptor_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)};
+	descriptor_pool_sizes.at(0).descriptorCount = settings::layer_cache::max_layers;
+
+	auto descriptor_pool_ci = init::descriptor_pool_create_info(descriptor_pool_sizes);
+	descriptor_pool_ci.maxSets = settings::layer_cache::max_layers;
+	vk_check_result(::vkCreateDescriptorPool(m_device->get_device(), &descriptor_pool_ci, nullptr, &m_descriptor.m_pool));
+}
+
+auto draw::layer_cache_t::create_layer() -> std::uint32_t
+{
+	if (m_layers.size() >= settings::layer_cache::max_layers)
+		return ~0u;
+
+	auto layer = layer_image_t{};
+
+	auto descriptor_set_ai = init::descriptor_set_allocate_info(m_descriptor.m_pool, m_descriptor.m_set_layout);
+	vk_check_result(::vkAllocateDescriptorSets(m_device->get_device(), &descriptor_set_ai, &layer.m_set));
+
+	this->create_target(layer);
+
+	m_layers.push_back(layer);
+	return static_cast<std::uint32_t>(m_layers.size() - 1);
+}
+
+auto draw::layer_cache_t::create_target(layer_image_t& layer) -> void
+{
+	auto image_ci = init::image_create_info(settings::color_format, m_extent, settings::layer_cache::usage);
+	vk_check_result(::vkCreateImage(m_device->get_device(), &image_ci, nullptr, &layer.m_image));
+
+	layer.m_allocation = m_device->allocate_image_memory(layer.m_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	auto image_view_ci = init::image_view_create_info(layer.m_image, settings::color_format, VK_IMAGE_ASPECT_COLOR_BIT);
+	vk_check_result(::vkCreateImageView(m_device->get_device(), &image_view_ci, nullptr, &layer.m_view));
+
+	auto attachments = std::array<VkImageView, 2>{layer.m_view, m_depth_view};
+	auto frame_buffer_ci = init::frame_buffer_create_info(m_render_pass, attachments, m_extent);
+	vk_check_result(::vkCreateFramebuffer(m_device->get_device(), &frame_buffer_ci, nullptr, &layer.m_frame_buffer));
+
+	// the set outlives the image, it is only pointed at the new view
+	auto descriptor_ii = init::descriptor_image_info(m_sampler, layer.m_view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	auto write_descriptor_set = init::write_descriptor_set(layer.m_set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, descriptor_ii);
+	::vkUpdateDescriptorSets(m_device->get_device(), 1, &write_descriptor_set, 0, nullptr);
+}
+
+auto draw::layer_cache_t::destroy_target(layer_image_t& layer) -> void
+{
+	if (layer.m_frame_buffer) ::vkDestroyFramebuffer(m_device->get_device(), layer.m_frame_buffer, nullptr);
+	if (layer.m_view) ::vkDestroyImageView(m_device->get_device(), layer.m_view, nullptr);
+	if (layer.m_image) ::vkDestroyImage(m_device->get_device(), layer.m_image, nullptr);
+	if (layer.m_allocation.m_memory) m_device->free_memory(layer.m_allocation);
+}
+
+auto draw::layer_cache_t::resize(VkImageView depth_view, VkExtent2D extent) -> void
+{
+	m_depth_view = depth_view;
+	m_extent = extent;
+
+	for (auto& layer : m_layers)
+	{
+		this->destroy_target(layer);
+		this->create_target(layer);
+	}
+}
+
+auto draw::layer_cache_t::get_render_pass() -> const VkRenderPass
+{
+	return m_render_pass;
+}
+
+auto draw::layer_cache_t::get_frame_buffer(std::uint32_t index) -> const VkFramebuffer
+{
+	return m_layers.at(index).m_frame_buffer;
+}
+
+auto draw::layer_cache_t::get_descriptor_set(std::uint32_t index) -> const VkDescriptorSet*
+{
+	return &m_layers.at(index).m_set;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "../device/device.hxx"
+#include "../utils/containers.hxx"
+
+namespace draw
+{
+	// screen sized images that keep what was drawn into them between frames, rendered with the
+	// swap chain pipelines through a compatible pass and sampled when composited
+	class layer_cache_t
+	{
+		device_t* m_device{nullptr};
+		VkImageView m_depth_view{nullptr}; // shared with the swap chain pass, the passes never overlap
+		VkExtent2D m_extent{}; // of the swap chain
+
+		VkRenderPass m_render_pass{nullptr};
+		VkSampler m_sampler{nullptr};
+
+		// descriptor
+		struct {
+			VkDescriptorSetLayout m_set_layout{nullptr};
+			VkDescriptorPool m_pool{nullptr};
+		} m_descriptor{};
+
+		std::vector<layer_image_t> m_layers{};
+
+	public:
+
+		layer_cache_t(device_t* device, VkImageView depth_view, VkExtent2D extent);
+
+		~layer_cache_t();
+
+	private:
+
+		auto create_render_pass() -> void;
+
+		auto create_descriptors() -> void;
+
+		auto create_target(layer_image_t& layer) -> void;
+
+		auto destroy_target(layer_image_t& layer) -> void;
+
+	public:
+
+		auto create_layer() -> std::uint32_t;
+
+		// every layer gets new images, their content is lost and has to be redrawn
+		auto resize(VkImageView depth_view, VkExtent2D extent) -> void;
+
+		auto get_render_pass() -> const VkRenderPass;
+
+		auto get_frame_buffer(std::uint32_t index) -> const VkFramebuffer;
+
+		auto get_descriptor_set(std::uint32_t index) -> const VkDescriptorSet*;
+	};
+}
\ No newline at end of file
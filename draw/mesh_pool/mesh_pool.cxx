@@ -0,0 +1,110 @@
+#include "mesh_pool.hxx"
+
+#include "../utils/error.hxx"
+#include "../utils/settings.hxx"
+#include "../utils/init.hxx"
+
+draw::mesh_pool_t::mesh_pool_t(device_t* device, uploader_t* uploader)
+	: m_device{device},
+	m_uploader{uploader}
+{
+	this->create_buffer(m_vertex_buffer, settings::mesh_pool::min_size, settings::mesh_pool::vertex_usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	this->create_buffer(m_index_buffer, settings::mesh_pool::min_size, settings::mesh_pool::index_usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+draw::mesh_pool_t::~mesh_pool_t()
+{
+	this->destroy_buffer(m_index_buffer);
+	this->destroy_buffer(m_vertex_buffer);
+}
+
+auto draw::mesh_pool_t::create_buffer(memory_buffer_t& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) -> void
+{
+	buffer.m_size = size;
+
+	// written by the transfer queue while the graphics queue draws from it
+	auto queue_families = std::vector<std::uint32_t>{m_device->get_graphics_queue_index()};
+	if (m_device->get_transfer_queue_index() != m_device->get_graphics_queue_index())
+		queue_families.push_back(m_device->get_transfer_queue_index());
+
+	auto buffer_ci = init::buffer_create_info(size, usage, queue_families);
+	vk_check_result(::vkCreateBuffer(m_device->get_device(), &buffer_ci, nullptr, &buffer.m_buffer));
+
+	buffer.m_allocation = m_device->allocate_buffer_memory(buffer.m_buffer, properties);
+}
+
+auto draw::mesh_pool_t::destroy_buffer(memory_buffer_t& buffer) -> void
+{
+	if (buffer.m_buffer) ::vkDestroyBuffer(m_device->get_device(), buffer.m_buffer, nullptr);
+	if (buffer.m_allocation.m_memory) m_device->free_memory(buffer.m_allocation);
+
+	buffer = memory_buffer_t{};
+}
+
+auto draw::mesh_pool_t::reserve(memory_buffer_t& buffer, VkDeviceSize used, VkDeviceSize required, VkBufferUsageFlags usage) -> void
+{
+	if (required <= buffer.m_size)
+		return;
+
+	auto size = static_cast<VkDeviceSize>(buffer.m_size) * 2;
+	for (; size < required; ) size *= 2;
+
+	// frames in flight may still read the old buffer
+	vk_check_result(::vkDeviceWaitIdle(m_device->get_device()));
+
+	auto grown = memory_buffer_t{};
+	this->create_buffer(grown, size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (used) m_uploader->copy_buffer(buffer.m_buffer, grown.m_buffer, used);
+
+	// the old buffer is read until the copy finished
+	m_uploader->wait(m_uploader->submit());
+
+	this->destroy_buffer(buffer);
+	buffer = grown;
+}
+
+auto draw::mesh_pool_t::upload(memory_buffer_t& buffer, VkDeviceSize offset, const void* data, VkDeviceSize size) -> void
+{
+	// drawn from once the frame's submit waited on the upload
+	m_uploader->upload_buffer(buffer.m_buffer, offset, data, size);
+}
+
+auto draw::mesh_pool_t::add(const std::vector<vertex_t>& vertices, const std::vector<std::uint32_t>& indices) -> mesh_handle_t
+{
+	auto vertex_size = VkDeviceSize{sizeof(vertex_t) * vertices.size()};
+	auto index_size = VkDeviceSize{sizeof(std::uint32_t) * indices.size()};
+
+	this->reserve(m_vertex_buffer, m_vertex_head, m_vertex_head + vertex_size, settings::mesh_pool::vertex_usage);
+	this->reserve(m_index_buffer, m_index_head, m_index_head + index_size, settings::mesh_pool::index_usage);
+
+	if (vertex_size) this->upload(m_vertex_buffer, m_vertex_head, vertices.data(), vertex_size);
+	if (index_size) this->upload(m_index_buffer, m_index_head, indices.data(), index_size);
+
+	m_meshes.push_back(
+		mesh_range_t{
+			static_cast<std::uint32_t>(m_index_head / sizeof(std::uint32_t)),
+			static_cast<std::uint32_t>(indices.size()),
+			static_cast<std::int32_t>(m_vertex_head / sizeof(vertex_t))
+		}
+	);
+
+	m_vertex_head += vertex_size;
+	m_index_head += index_size;
+
+	return mesh_handle_t{static_cast<std::uint32_t>(m_meshes.size() - 1)};
+}
+
+auto draw::mesh_pool_t::get_mesh(mesh_handle_t mesh) -> const mesh_range_t&
+{
+	return m_meshes.at(mesh.m_index);
+}
+
+auto draw::mesh_pool_t::get_vertex_buffer() -> const VkBuffer&
+{
+	return m_vertex_buffer.m_buffer;
+}
+
+auto draw::mesh_pool_t::get_index_buffer() -> const VkBuffer&
+{
+	return m_index_buffer.m_buffer;
+}
\ No newline at end of file
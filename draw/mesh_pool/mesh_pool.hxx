@@ -0,0 +1,55 @@
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "../device/device.hxx"
+#include "../uploader/uploader.hxx"
+#include "../utils/containers.hxx"
+
+namespace draw
+{
+	// device local vertex / index storage for meshes uploaded once and drawn many times
+	class mesh_pool_t
+	{
+		device_t* m_device{nullptr};
+		uploader_t* m_uploader{nullptr};
+
+		memory_buffer_t m_vertex_buffer{};
+		memory_buffer_t m_index_buffer{};
+
+		VkDeviceSize m_vertex_head{0}; // bytes in use
+		VkDeviceSize m_index_head{0};
+
+		std::vector<mesh_range_t> m_meshes{};
+
+	public:
+
+		mesh_pool_t(device_t* device, uploader_t* uploader);
+
+		~mesh_pool_t();
+
+	private:
+
+		auto create_buffer(memory_buffer_t& buffer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) -> void;
+
+		auto destroy_buffer(memory_buffer_t& buffer) -> void;
+
+		auto reserve(memory_buffer_t& buffer, VkDeviceSize used, VkDeviceSize required, VkBufferUsageFlags usage) -> void;
+
+		auto upload(memory_buffer_t& buffer, VkDeviceSize offset, const void* data, VkDeviceSize size) -> void;
+
+	public:
+
+		auto add(const std::vector<vertex_t>& vertices, const std::vector<std::uint32_t>& indices) -> mesh_handle_t;
+
+		auto get_mesh(mesh_handle_t mesh) -> const mesh_range_t&;
+
+		auto get_vertex_buffer() -> const VkBuffer&;
+
+		auto get_index_buffer() -> const VkBuffer&;
+	};
+}
\ No newline at end of file
@@ -5,7 +5,7 @@
 #include <vulkan/vulkan.h>
 
 #include "../device/device.hxx"
-#include "../swap_chain/swap_chain.hxx"
+#include "../uploader/uploader.hxx"
 #include "../utils/containers.hxx"
 #include "../utils/settings.hxx"
 #include "../fonts/stb_font_consolas_24_latin1.inl"
@@ -15,7 +15,6 @@ namespace draw
 	class pipeline_t
 	{
 		device_t* m_device{nullptr};
-		swap_chain_t* m_swap_chain{nullptr};
 
 		// descriptor
 		struct {
@@ -24,56 +23,56 @@ namespace draw
 			VkDescriptorSet m_set{ nullptr };
 		} m_descriptor{ };
 
-		// pipeline cache
-		VkPipelineCache m_pipeline_cache{nullptr};
-		
 		// image
 		struct {
 			VkImage m_image{ nullptr };
-			VkDeviceMemory m_memory{ nullptr };
+			memory_allocation_t m_allocation{ };
 			VkImageView m_view{ nullptr };
 			VkSampler m_sampler{ nullptr };
 		} m_image{ };
 
-		// shaders
-		struct {
-			VkShaderModule m_vertex{ nullptr };
-			VkShaderModule m_fragment{ nullptr };
-		} m_shaders;
+		// glyph metrics, indexed by the text vertex shader
+		memory_buffer_t m_glyph_buffer{ };
 
-		// pipeline
+		// pipeline, created on first use with settings::startup::lazy_pipelines
+		const pipeline_setting_t* m_setting{nullptr};
+		shader_modules_t m_shaders{ };
+		VkRenderPass m_render_pass{nullptr};
+		VkPipelineCache m_pipeline_cache{nullptr};
 		VkPipeline m_graphics_pipeline{nullptr};
 
 	public:
 
 		VkPipelineLayout m_pipeline_layout{nullptr};
 
-		pipeline_t(const pipeline_setting_t& setting, device_t* device, swap_chain_t* swap_chain, VkRenderPass render_pass);
+		pipeline_t(const pipeline_setting_t& setting, const shader_modules_t& shaders, device_t* device, VkRenderPass render_pass, VkPipelineCache pipeline_cache);
 
-		pipeline_t(const pipeline_setting_t& setting, device_t* device, swap_chain_t* swap_chain, VkRenderPass render_pass, stb_fontchar* font_data);
+		// font_pixels as rasterized into font_data
+		pipeline_t(const pipeline_setting_t& setting, const shader_modules_t& shaders, device_t* device, VkRenderPass render_pass, VkPipelineCache pipeline_cache, uploader_t* uploader, const stb_fontchar* font_data, const std::uint8_t* font_pixels);
 		
 		~pipeline_t();
 
 	private:
 
-		auto create_descriptor_set_layout(VkDescriptorType desc_type, VkShaderStageFlags shader_stage) -> void;
+		auto create_descriptor_set_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings) -> void;
 
-		auto create_descriptor_pool(VkDescriptorType desc_type) -> void;
+		auto create_descriptor_pool(const std::vector<VkDescriptorSetLayoutBinding>& bindings) -> void;
 		
-		auto create_descriptor_set(VkDescriptorType desc_type) -> void;
+		auto create_descriptor_set() -> void;
 
-		auto create_font_image(stb_fontchar* font_data) -> void;
+		auto create_pipeline_layout(const pipeline_setting_t& p_settings) -> void;
 
-		auto create_pipeline_cache() -> void;
+		auto create_font_image(uploader_t* uploader, const std::uint8_t* font_pixels) -> void;
 
-		auto read_shader_file(const std::string& file_name) -> VkShaderModule;
+		auto create_glyph_buffer(const stb_fontchar* font_data) -> void;
 
-		auto create_graphics_pipeline(const pipeline_setting_t& p_settings, VkRenderPass render_pass) -> void;
+		auto create_graphics_pipeline() -> void;
 
 	public:
 
 		auto get_descriptor_set() -> const VkDescriptorSet*;
 
+		// compiles the pipeline if it was deferred
 		auto get_graphics_pipeline() -> const VkPipeline;
 	};
 }
\ No newline at end of file
@@ -1,94 +1,440 @@
 #include "renderer.hxx"
 
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include <utility>
+#include <cmath>
+
 #include "../utils/error.hxx"
 #include "../utils/constants.hxx"
 #include "../utils/settings.hxx"
 #include "../utils/init.hxx"
 
+thread_local std::uint32_t draw::renderer_t::s_recorder{0};
+
 draw::renderer_t::renderer_t(const HWND window_handle, stb_fontchar* font_data)
 {
-	// construct m_device
-	m_device = new device_t{ };
-
-	// construct m_swap_chain
-	m_swap_chain = new swap_chain_t{
-		m_device->get_instance(),
-		m_device->get_device(),
-		window_handle,
-		m_device->get_graphics_queue_index()
+	// independent steps overlap, each waits only for what it reads
+	auto startup = task_graph_t{};
+	auto font_pixels = std::vector<std::uint8_t>{};
+
+	auto device = startup.add("device", [&] { m_device = new device_t{ }; });
+	auto font = startup.add("font atlas", [&] { font_pixels = this->rasterize_font(font_data); });
+
+	auto swap_chain = startup.add("swap chain", [&] {
+		m_swap_chain = new swap_chain_t{
+			m_device->get_instance(),
+			m_device->get_physical_device(),
+			m_device->get_device(),
+			window_handle,
+			m_requested_extent,
+			m_device->get_graphics_queue_index(),
+			m_device->get_present_wait(),
+			m_device->get_incremental_present(),
+			m_present_mode
+		};
+
+		m_extent = m_swap_chain->get_extent();
+	}, {device});
+
+	// streams textures and meshes on the transfer queue
+	auto uploader = startup.add("uploader", [&] { m_uploader = new uploader_t{m_device}; }, {device});
+
+	auto pipeline_cache = startup.add("pipeline cache", [&] { this->create_pipeline_cache(); }, {device});
+	auto shader_modules = startup.add("shader modules", [&] { this->create_shader_modules(); }, {device});
+	auto render_pass = startup.add("render pass", [&] { this->create_render_pass(); }, {device});
+	auto depth_stencil = startup.add("depth stencil", [&] { this->setup_depth_stencil(); }, {swap_chain});
+	auto offscreen = startup.add("offscreen", [&] { this->create_offscreen(); }, {swap_chain, render_pass});
+	startup.add("frame buffers", [&] { this->create_frame_buffers(); }, {swap_chain, render_pass, depth_stencil, offscreen});
+
+	// offscreen targets of cached layers, drawn with the same pipelines
+	startup.add("layer cache", [&] { m_layer_cache = new layer_cache_t{m_device, m_depth_stencil.m_view, m_extent}; }, {depth_stencil});
+
+	// worker threads and their command pools, large passes are recorded side by side
+	startup.add("recorders", [&] { this->create_recorders(); }, {swap_chain});
+
+	// pipelines compile side by side, vkCreateGraphicsPipelines synchronizes the shared cache itself
+	auto add_pipeline = [&](const char* name, pipeline_t** pipeline, const pipeline_setting_t* setting) {
+		startup.add(name, [this, pipeline, setting] {
+			*pipeline = new pipeline_t{*setting, this->get_shader_modules(*setting), m_device, m_render_pass, m_pipeline_cache};
+		}, {render_pass, pipeline_cache, shader_modules});
 	};
 
-	this->create_render_pass();
-	this->setup_depth_stencil();
-	this->create_frame_buffers();
+	add_pipeline("mesh pipeline", &m_mesh_pipeline, &settings::pipelines::mesh); // opaque meshes
+	add_pipeline("translucent mesh pipeline", &m_translucent_mesh_pipeline, &settings::pipelines::translucent_mesh); // translucent meshes
+	add_pipeline("retained pipeline", &m_retained_pipeline, &settings::pipelines::retained); // retained meshes
+	add_pipeline("winding pipeline", &m_winding_pipeline, &settings::pipelines::polygon_winding); // polygon stencil pass
+	add_pipeline("cover pipeline", &m_cover_pipeline, &settings::pipelines::polygon_cover); // polygon cover pass
+	add_pipeline("line pipeline", &m_line_pipeline, &settings::pipelines::line); // lines
+	add_pipeline("shape pipeline", &m_shape_pipeline, &settings::pipelines::shape); // circles, rings, arcs, rounded rects
+	add_pipeline("composite pipeline", &m_composite_pipeline, &settings::pipelines::composite); // cached layers
+
+	// text
+	startup.add("text pipeline", [&] {
+		m_text_pipeline = new pipeline_t{settings::pipelines::text, this->get_shader_modules(settings::pipelines::text), m_device, m_render_pass, m_pipeline_cache, m_uploader, font_data, font_pixels.data()};
+	}, {render_pass, pipeline_cache, shader_modules, uploader, font});
+
+	// one persistently mapped vertex / index buffer shared by every pipeline
+	startup.add("vertex ring", [&] {
+		m_vertex_ring = new ring_buffer_t{m_device, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_swap_chain->get_frame_count()};
+	}, {swap_chain});
+
+	// device local storage for meshes registered once
+	startup.add("mesh pool", [&] { m_mesh_pool = new mesh_pool_t{m_device, m_uploader}; }, {uploader});
+
+	// optional compute culling of the ring's primitive streams
+	startup.add("culling", [&] {
+		m_culling = new culling_t{m_device, this->get_shader_module(settings::shaders::cull_compute), m_pipeline_cache, m_swap_chain->get_frame_count()};
+	}, {swap_chain, pipeline_cache, shader_modules});
+
+	startup.run(std::min(std::max(std::thread::hardware_concurrency(), 1u), settings::startup::max_threads));
 
-	// construct pipelines
-	m_mesh_pipeline = new pipeline_t{settings::pipelines::mesh, m_device, m_swap_chain, m_render_pass}; // meshes
-	m_line_pipeline = new pipeline_t{settings::pipelines::line, m_device, m_swap_chain, m_render_pass}; // lines
-	m_text_pipeline = new pipeline_t{settings::pipelines::text, m_device, m_swap_chain, m_render_pass, font_data}; // text
+	if (settings::startup::report)
+		startup.report(std::cout);
 
 	this->prepare_render_pass();
 }
 
 draw::renderer_t::~renderer_t()
 {
+	// frames in flight may still be executing
+	if (m_device) ::vkDeviceWaitIdle(m_device->get_device());
+
+	if (m_thread_pool) delete m_thread_pool;
+
+	// freeing the pools frees their secondary buffers
+	for (const auto& recorder : m_recorders)
+		for (auto command_pool : recorder.m_command_pools) ::vkDestroyCommandPool(m_device->get_device(), command_pool, nullptr);
+
+	if (m_culling) delete m_culling;
+	if (m_mesh_pool) delete m_mesh_pool;
+	if (m_vertex_ring) delete m_vertex_ring;
+
 	// destruct pipelines
+	if (m_composite_pipeline) delete m_composite_pipeline;
 	if (m_text_pipeline) delete m_text_pipeline;
+	if (m_shape_pipeline) delete m_shape_pipeline;
 	if (m_line_pipeline) delete m_line_pipeline;
+	if (m_cover_pipeline) delete m_cover_pipeline;
+	if (m_winding_pipeline) delete m_winding_pipeline;
+	if (m_retained_pipeline) delete m_retained_pipeline;
+	if (m_translucent_mesh_pipeline) delete m_translucent_mesh_pipeline;
+	if (m_mesh_pipeline) delete m_mesh_pipeline;
 
-	// frame buffers
-	if (m_swap_chain) for (auto& frame_buffer : m_frame_buffers) ::vkDestroyFramebuffer(m_device->get_device(), frame_buffer, nullptr);
+	if (m_layer_cache) delete m_layer_cache;
 
-	// depth stencil
-	if (m_depth_stencil.m_memory) ::vkFreeMemory(m_device->get_device(), m_depth_stencil.m_memory, nullptr);
-	if (m_depth_stencil.m_view) ::vkDestroyImageView(m_device->get_device(), m_depth_stencil.m_view, nullptr);
-	if (m_depth_stencil.m_image) ::vkDestroyImage(m_device->get_device(), m_depth_stencil.m_image, nullptr);
+	// shader modules
+	for (auto& [code, shader_module] : m_shader_modules) ::vkDestroyShaderModule(m_device->get_device(), shader_module, nullptr);
+
+	// frame buffers, depth stencil and the offscreen image
+	if (m_device) this->destroy_targets();
+	if (m_offscreen.m_query_pool) ::vkDestroyQueryPool(m_device->get_device(), m_offscreen.m_query_pool, nullptr);
 
-	// render pass
+	// pipeline cache, kept for the next launch
+	if (m_pipeline_cache) this->save_pipeline_cache();
+	if (m_pipeline_cache) ::vkDestroyPipelineCache(m_device->get_device(), m_pipeline_cache, nullptr);
+
+	// render passes
+	if (m_offscreen.m_render_pass) ::vkDestroyRenderPass(m_device->get_device(), m_offscreen.m_render_pass, nullptr);
 	if (m_render_pass) ::vkDestroyRenderPass(m_device->get_device(), m_render_pass, nullptr);
 
+	if (m_uploader) delete m_uploader;
 	if (m_swap_chain) delete m_swap_chain; // destruct m_swap_chain
 	if (m_device) delete m_device; // destruct m_device
 }
 
+auto draw::renderer_t::pipeline_cache_header(std::uint64_t size) -> pipeline_cache_header_t
+{
+	const auto& properties = m_device->get_physical_device_properties();
+
+	auto header = pipeline_cache_header_t{settings::pipeline_cache::magic, properties.vendorID, properties.deviceID, properties.driverVersion};
+	std::copy(std::begin(properties.pipelineCacheUUID), std::end(properties.pipelineCacheUUID), header.m_uuid.begin());
+	header.m_size = size;
+
+	return header;
+}
+
+auto draw::renderer_t::pipeline_cache_path() -> std::filesystem::path
+{
+	// next to the executable, whatever the working directory
+	auto module_path = std::wstring(MAX_PATH, L'\0');
+	auto length = ::GetModuleFileNameW(nullptr, module_path.data(), static_cast<DWORD>(module_path.size()));
+	if (!length || length == module_path.size()) // failed or truncated
+		return settings::pipeline_cache::file_name;
+
+	module_path.resize(length);
+	return std::filesystem::path{module_path}.parent_path() / settings::pipeline_cache::file_name;
+}
+
+auto draw::renderer_t::create_pipeline_cache() -> void
+{
+	auto expected = this->pipeline_cache_header(0);
+	auto path = this->pipeline_cache_path();
+
+	// a size that doesn't match the file is a truncated or corrupt cache, never allocated
+	auto error = std::error_code{};
+	auto file_size = std::filesystem::file_size(path, error);
+
+	// data from another device or driver would be rejected or worse, start empty instead
+	auto cache_data = std::vector<std::uint8_t>{};
+	auto cache_file = std::ifstream{path, std::ios::binary};
+
+	auto header = pipeline_cache_header_t{};
+	if (!error && cache_file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+		header.m_size == file_size - sizeof(header) &&
+		header.m_magic == expected.m_magic &&
+		header.m_vendor == expected.m_vendor &&
+		header.m_device == expected.m_device &&
+		header.m_driver_version == expected.m_driver_version &&
+		header.m_uuid == expected.m_uuid)
+	{
+		cache_data.resize(header.m_size);
+		if (!cache_file.read(reinterpret_cast<char*>(cache_data.data()), cache_data.size()))
+			cache_data.clear(); // truncated
+	}
+
+	auto pipeline_cache_ci = init::pipeline_cache_create_info(cache_data);
+	vk_check_result(::vkCreatePipelineCache(m_device->get_device(), &pipeline_cache_ci, nullptr, &m_pipeline_cache));
+}
+
+auto draw::renderer_t::save_pipeline_cache() -> void
+{
+	auto cache_size = std::size_t{0};
+	vk_check_result(::vkGetPipelineCacheData(m_device->get_device(), m_pipeline_cache, &cache_size, nullptr));
+
+	auto cache_data = std::vector<std::uint8_t>(cache_size);
+	vk_check_result(::vkGetPipelineCacheData(m_device->get_device(), m_pipeline_cache, &cache_size, cache_data.data()));
+
+	auto header = this->pipeline_cache_header(cache_size);
+
+	// written next to the old file and swapped in, a crash mid write leaves the old cache intact
+	auto path = this->pipeline_cache_path();
+	auto temp_path = std::filesystem::path{path} += ".tmp";
+	{
+		auto cache_file = std::ofstream{temp_path, std::ios::binary | std::ios::trunc};
+		cache_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		cache_file.write(reinterpret_cast<const char*>(cache_data.data()), cache_size);
+
+		if (!cache_file.flush())
+			return;
+	}
+
+	auto error = std::error_code{};
+	std::filesystem::rename(temp_path, path, error);
+}
+
+auto draw::renderer_t::create_shader_modules() -> void
+{
+	// pipelines sharing a stage share its module, e.g. mesh.frag
+	for (auto code : settings::shaders::all)
+	{
+		if (m_shader_modules.contains(code.data()))
+			continue;
+
+		auto shader_module_ci = init::shader_module_create_info(code.size_bytes(), code.data());
+		auto shader_module = VkShaderModule{nullptr};
+		vk_check_result(::vkCreateShaderModule(m_device->get_device(), &shader_module_ci, nullptr, &shader_module));
 
+		m_shader_modules.emplace(code.data(), shader_module);
+	}
+}
+
+auto draw::renderer_t::get_shader_module(std::span<const std::uint32_t> code) -> VkShaderModule
+{
+	// read only once created, pipelines look modules up from several threads
+	return m_shader_modules.at(code.data());
+}
+
+auto draw::renderer_t::get_shader_modules(const pipeline_setting_t& setting) -> shader_modules_t
+{
+	return shader_modules_t{this->get_shader_module(setting.m_vertex), this->get_shader_module(setting.m_fragment)};
+}
+
+auto draw::renderer_t::rasterize_font(stb_fontchar* font_data) -> std::vector<std::uint8_t>
+{
+	// fills font_data, the scene lays text out with it
+	auto font_pixels = std::vector<std::uint8_t>(settings::font::extent.width * settings::font::extent.height);
+	::stb_font_consolas_24_latin1(font_data, reinterpret_cast<std::uint8_t(*)[settings::font::extent.width]>(font_pixels.data()), settings::font::extent.height);
+
+	return font_pixels;
+}
 
 auto draw::renderer_t::create_render_pass() -> void
 {
 	auto color_attachment_ref = VkAttachmentReference{std::uint32_t{0}, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
 	auto depth_attachment_ref = VkAttachmentReference{std::uint32_t{1}, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
 
-	auto attachments = init::attachment_descriptions(settings::color_format, settings::depth_format);
+	auto attachments = init::attachment_descriptions(settings::color_format, settings::depth_format, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 	auto subpass = init::subpass_description(color_attachment_ref, depth_attachment_ref);
-	auto dependencies = init::subpass_dependencies();
+	auto dependencies = init::subpass_dependencies(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_ACCESS_MEMORY_READ_BIT);
 
 	auto render_pass_ci = init::render_pass_create_info(attachments, subpass, dependencies);
 	vk_check_result(::vkCreateRenderPass(m_device->get_device(), &render_pass_ci, nullptr, &m_render_pass));
+
+	// only the final layout differs, the swap chain pipelines stay compatible
+	auto offscreen_attachments = init::attachment_descriptions(settings::color_format, settings::depth_format, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	auto offscreen_dependencies = init::subpass_dependencies(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+	auto offscreen_pass_ci = init::render_pass_create_info(offscreen_attachments, subpass, offscreen_dependencies);
+	vk_check_result(::vkCreateRenderPass(m_device->get_device(), &offscreen_pass_ci, nullptr, &m_offscreen.m_render_pass));
 }
 
 auto draw::renderer_t::setup_depth_stencil() -> void
 {
-	auto image_ci = init::image_create_info(settings::depth_format, window::res_vk, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	auto image_ci = init::image_create_info(settings::depth_format, m_extent, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
 	vk_check_result(::vkCreateImage(m_device->get_device(), &image_ci, nullptr, &m_depth_stencil.m_image));
-	
-	auto image_memory_reqs = VkMemoryRequirements{ };
-	::vkGetImageMemoryRequirements(m_device->get_device(), m_depth_stencil.m_image, &image_memory_reqs);
-
-	auto memory_ai = VkMemoryAllocateInfo{ };
-	memory_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memory_ai.allocationSize = image_memory_reqs.size;
-	memory_ai.memoryTypeIndex = m_device->get_memory_type_index(image_memory_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	vk_check_result(::vkAllocateMemory(m_device->get_device(), &memory_ai, nullptr, &m_depth_stencil.m_memory));
-	vk_check_result(::vkBindImageMemory(m_device->get_device(), m_depth_stencil.m_image, m_depth_stencil.m_memory, 0));
+	m_depth_stencil.m_allocation = m_device->allocate_image_memory(m_depth_stencil.m_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	auto image_view_ci = init::image_view_create_info(m_depth_stencil.m_image, settings::depth_format);
+	auto image_view_ci = init::image_view_create_info(m_depth_stencil.m_image, settings::depth_format, VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT);
 	vk_check_result(::vkCreateImageView(m_device->get_device(), &image_view_ci, nullptr, &m_depth_stencil.m_view));
 }
 
+auto draw::renderer_t::create_offscreen() -> void
+{
+	// timestamps are all dynamic resolution has to go by
+	if (!m_offscreen.m_query_pool && m_device->get_physical_device_properties().limits.timestampComputeAndGraphics)
+	{
+		auto query_pool_ci = init::query_pool_create_info(VK_QUERY_TYPE_TIMESTAMP, m_swap_chain->get_frame_count() * 2);
+		vk_check_result(::vkCreateQueryPool(m_device->get_device(), &query_pool_ci, nullptr, &m_offscreen.m_query_pool));
+
+		m_offscreen.m_timed.assign(m_swap_chain->get_frame_count(), false);
+		m_offscreen.m_timestamp_period = m_device->get_physical_device_properties().limits.timestampPeriod;
+	}
+
+	if (!m_offscreen.m_enabled || !m_offscreen.m_query_pool)
+		return;
+
+	// full size, only the scaled corner is drawn to so a new scale needs no new image
+	auto image_ci = init::image_create_info(settings::color_format, m_extent, settings::resolution::offscreen_usage);
+	vk_check_result(::vkCreateImage(m_device->get_device(), &image_ci, nullptr, &m_offscreen.m_image));
+	m_offscreen.m_allocation = m_device->allocate_image_memory(m_offscreen.m_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	auto image_view_ci = init::image_view_create_info(m_offscreen.m_image, settings::color_format, VK_IMAGE_ASPECT_COLOR_BIT);
+	vk_check_result(::vkCreateImageView(m_device->get_device(), &image_view_ci, nullptr, &m_offscreen.m_view));
+}
+
+auto draw::renderer_t::destroy_targets() -> void
+{
+	for (auto& frame_buffer : m_frame_buffers) ::vkDestroyFramebuffer(m_device->get_device(), frame_buffer, nullptr);
+	m_frame_buffers.clear();
+
+	if (m_offscreen.m_frame_buffer) ::vkDestroyFramebuffer(m_device->get_device(), m_offscreen.m_frame_buffer, nullptr);
+	if (m_offscreen.m_view) ::vkDestroyImageView(m_device->get_device(), m_offscreen.m_view, nullptr);
+	if (m_offscreen.m_image) ::vkDestroyImage(m_device->get_device(), m_offscreen.m_image, nullptr);
+	if (m_offscreen.m_allocation.m_memory) m_device->free_memory(m_offscreen.m_allocation);
+
+	if (m_depth_stencil.m_view) ::vkDestroyImageView(m_device->get_device(), m_depth_stencil.m_view, nullptr);
+	if (m_depth_stencil.m_image) ::vkDestroyImage(m_device->get_device(), m_depth_stencil.m_image, nullptr);
+	if (m_depth_stencil.m_allocation.m_memory) m_device->free_memory(m_depth_stencil.m_allocation);
+
+	m_offscreen.m_frame_buffer = nullptr;
+	m_offscreen.m_view = nullptr;
+	m_offscreen.m_image = nullptr;
+	m_offscreen.m_allocation = memory_allocation_t{};
+	m_depth_stencil = {};
+}
+
+auto draw::renderer_t::recreate_targets() -> void
+{
+	// pipelines, buffers and the device are kept, only what depends on the swap chain images is rebuilt
+	vk_check_result(::vkDeviceWaitIdle(m_device->get_device()));
+
+	this->destroy_targets();
+
+	m_swap_chain->recreate(m_present_mode, m_requested_extent);
+	m_extent = m_swap_chain->get_extent();
+
+	this->setup_depth_stencil();
+	this->create_offscreen();
+	this->create_frame_buffers();
+	m_layer_cache->resize(m_depth_stencil.m_view, m_extent);
+
+	this->update_render_extent();
+	this->update_projection();
+
+	m_recreate = false;
+	m_targets_lost = true;
+}
+
+auto draw::renderer_t::update_render_extent() -> void
+{
+	// the projection keeps mapping onto m_extent, the viewport squeezes it into the scaled corner
+	auto scale = m_offscreen.m_view ? m_offscreen.m_scale : 1.0f;
+
+	m_render_extent = VkExtent2D{
+		std::max(static_cast<std::uint32_t>(std::ceil(m_extent.width * scale)), 1u),
+		std::max(static_cast<std::uint32_t>(std::ceil(m_extent.height * scale)), 1u)
+	};
+
+	m_viewport = init::viewport(m_render_extent);
+	m_render_pass_bi.renderArea.extent = m_render_extent;
+	m_layer_pass_bi.renderArea.extent = m_render_extent;
+}
+
+auto draw::renderer_t::update_render_scale() -> void
+{
+	// once per recorded frame, skipped frames leave the slot's queries alone
+	auto frame = m_swap_chain->get_frame_index();
+	if (!m_offscreen.m_timed.at(frame))
+		return;
+
+	m_offscreen.m_timed.at(frame) = false;
+
+	// the frame's fence was waited on, its timestamps are available
+	auto timestamps = std::array<std::uint64_t, 2>{};
+	if (::vkGetQueryPoolResults(m_device->get_device(), m_offscreen.m_query_pool, frame * 2, 2, sizeof(timestamps), timestamps.data(), sizeof(std::uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	auto gpu_time = static_cast<std::float_t>(timestamps[1] - timestamps[0]) * m_offscreen.m_timestamp_period / 1000000.0f;
+	m_offscreen.m_gpu_time += (gpu_time - m_offscreen.m_gpu_time) * settings::resolution::smoothing;
+
+	// the cost follows the pixel count, the square of the scale, rounded down to whole steps
+	auto estimate = m_offscreen.m_scale * std::sqrt(settings::resolution::target_time / std::max(m_offscreen.m_gpu_time, 0.001f));
+	auto scale = std::clamp(std::floor(estimate / settings::resolution::scale_step) * settings::resolution::scale_step, settings::resolution::min_scale, 1.0f);
+
+	// shrinks when over the target, only grows back with headroom so it doesn't flip between two steps
+	auto over = m_offscreen.m_gpu_time > settings::resolution::target_time && scale < m_offscreen.m_scale;
+	auto under = m_offscreen.m_gpu_time < settings::resolution::target_time * settings::resolution::headroom && scale > m_offscreen.m_scale;
+
+	if (!over && !under)
+		return;
+
+	// what the smoothed time would have been at the new scale
+	m_offscreen.m_gpu_time *= (scale * scale) / (m_offscreen.m_scale * m_offscreen.m_scale);
+	m_offscreen.m_scale = scale;
+
+	this->update_render_extent();
+	m_targets_lost = true;
+}
+
+auto draw::renderer_t::blit_offscreen() -> void
+{
+	auto command_buffer = m_swap_chain->get_render_buffer();
+	auto swap_chain_image = m_swap_chain->get_image_views().at(m_swap_chain->get_buffer_index()).m_image;
+	auto range = init::image_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT);
+
+	// chained to the acquire semaphore, which is waited on at the color attachment stage
+	auto to_transfer = init::image_memory_barier(0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, swap_chain_image, range);
+	::vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_transfer);
+
+	auto blit = init::image_blit(m_render_extent, m_extent);
+	::vkCmdBlitImage(command_buffer, m_offscreen.m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, swap_chain_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+	auto to_present = init::image_memory_barier(VK_ACCESS_TRANSFER_WRITE_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, swap_chain_image, range);
+	::vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &to_present);
+
+	// the offscreen image is shared by every frame in flight, the next pass must not draw over it before the blit read it
+	::vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+}
+
 auto draw::renderer_t::create_frame_buffers() -> void
 {
 	auto attachments = std::array<VkImageView, 2>{ nullptr, m_depth_stencil.m_view };
-	auto frame_buffer_ci = init::frame_buffer_create_info(m_render_pass, attachments, window::res_vk);
+	auto frame_buffer_ci = init::frame_buffer_create_info(m_render_pass, attachments, m_extent);
 
 	m_frame_buffers.resize(m_swap_chain->get_image_views().size());
 	for (auto i = std::uint32_t{0}; i < m_frame_buffers.size(); i++)
@@ -96,6 +442,13 @@ auto draw::renderer_t::create_frame_buffers() -> void
 		attachments[0] = m_swap_chain->get_image_views().at(i).m_view;
 		vk_check_result(::vkCreateFramebuffer(m_device->get_device(), &frame_buffer_ci, nullptr, &m_frame_buffers.at(i)));
 	}
+
+	if (!m_offscreen.m_view)
+		return;
+
+	attachments[0] = m_offscreen.m_view;
+	frame_buffer_ci.renderPass = m_offscreen.m_render_pass;
+	vk_check_result(::vkCreateFramebuffer(m_device->get_device(), &frame_buffer_ci, nullptr, &m_offscreen.m_frame_buffer));
 }
 
 auto draw::renderer_t::prepare_render_pass() -> void
@@ -104,152 +457,555 @@ auto draw::renderer_t::prepare_render_pass() -> void
 	m_clear_values[1].depthStencil = settings::pass_depth;
 
 	m_render_command_buffer_bi = init::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-	m_render_pass_bi = init::render_pass_begin_info(m_render_pass, nullptr, window::res_vk, m_clear_values);
+	m_render_pass_bi = init::render_pass_begin_info(m_render_pass, nullptr, m_extent, m_clear_values);
+
+	m_layer_clear_values[0].color = settings::layer_cache::clear_color;
+	m_layer_clear_values[1].depthStencil = settings::pass_depth;
+	m_layer_pass_bi = init::render_pass_begin_info(m_layer_cache->get_render_pass(), nullptr, m_extent, m_layer_clear_values);
+
+	this->update_render_extent();
+	this->update_projection();
+}
+
+auto draw::renderer_t::update_projection() -> void
+{
+	// pixels to clip space, folded with the user transform
+	auto scale = vec2_t{2.0f / static_cast<std::float_t>(m_extent.width), 2.0f / static_cast<std::float_t>(m_extent.height)};
+
+	m_push_constants.m_row_x = {m_transform.m_a * scale.m_x, m_transform.m_b * scale.m_x, m_transform.m_translation.m_x * scale.m_x - 1.0f, 0.0f};
+	m_push_constants.m_row_y = {m_transform.m_c * scale.m_y, m_transform.m_d * scale.m_y, m_transform.m_translation.m_y * scale.m_y - 1.0f, 0.0f};
+}
+
+auto draw::renderer_t::create_recorders() -> void
+{
+	m_thread_pool = new thread_pool_t{std::min(std::max(std::thread::hardware_concurrency(), 1u), settings::recording::max_threads)};
+	m_recorders.resize(m_thread_pool->get_thread_count());
+
+	// command pools are externally synchronized, every thread gets its own per frame in flight
+	auto command_pool_ci = init::command_pool_create_info(m_device->get_graphics_queue_index(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	for (auto& recorder : m_recorders)
+	{
+		recorder.m_command_pools.resize(m_swap_chain->get_frame_count());
+		recorder.m_secondary_buffers.resize(m_swap_chain->get_frame_count());
+
+		for (auto& command_pool : recorder.m_command_pools)
+			vk_check_result(::vkCreateCommandPool(m_device->get_device(), &command_pool_ci, nullptr, &command_pool));
+	}
+}
+
+auto draw::renderer_t::recorder() -> recorder_t&
+{
+	return m_recorders.at(s_recorder);
+}
+
+auto draw::renderer_t::secondary_buffer(recorder_t& recorder) -> VkCommandBuffer
+{
+	auto frame_index = m_swap_chain->get_frame_index();
+	auto& buffers = recorder.m_secondary_buffers.at(frame_index);
+
+	// the pool was reset when the frame began, its buffers are reused in order
+	if (recorder.m_used == buffers.size())
+	{
+		auto command_buffer_ai = init::command_buffer_allocate_info(recorder.m_command_pools.at(frame_index), 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		buffers.push_back(nullptr);
+		vk_check_result(::vkAllocateCommandBuffers(m_device->get_device(), &command_buffer_ai, &buffers.back()));
+	}
+
+	return buffers.at(recorder.m_used++);
+}
+
+auto draw::renderer_t::begin_recording(recorder_t& recorder) -> void
+{
+	::vkCmdSetViewport(recorder.m_command_buffer, 0, 1, &m_viewport);
+
+	recorder.m_bound_pipeline = nullptr;
+	recorder.m_clip_id = ~0u;
+	this->set_clip(0); // every pipeline takes a dynamic scissor
 }
 
-auto draw::renderer_t::create_vertex_buffer(memory_buffer_t& vertex_buffer) -> void
+auto draw::renderer_t::bind_pipeline(pipeline_t* pipeline) -> void
 {
-	// destroy buffer
-	if (vertex_buffer.m_buffer) ::vkDestroyBuffer(m_device->get_device(), vertex_buffer.m_buffer, nullptr);
-	if (vertex_buffer.m_memory) ::vkFreeMemory(m_device->get_device(), vertex_buffer.m_memory, nullptr);
+	auto& recorder = this->recorder();
 
-	// allocate buffer
-	auto vertex_buffer_ci = init::buffer_create_info(vertex_buffer.m_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-	auto memory_requirements = init::memory_requirements();
-	auto memory_ai = init::memory_allocate_info();
+	// sorted commands share pipelines back to back, only switches are recorded
+	if (recorder.m_bound_pipeline == pipeline)
+		return;
 
-	::vkCreateBuffer(m_device->get_device(), &vertex_buffer_ci, nullptr, &vertex_buffer.m_buffer);
-	::vkGetBufferMemoryRequirements(m_device->get_device(), vertex_buffer.m_buffer, &memory_requirements);
-	memory_ai.allocationSize = memory_requirements.size;
-	memory_ai.memoryTypeIndex = m_device->get_memory_type_index(memory_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-	::vkAllocateMemory(m_device->get_device(), &memory_ai, nullptr, &vertex_buffer.m_memory);
-	::vkBindBufferMemory(m_device->get_device(), vertex_buffer.m_buffer, vertex_buffer.m_memory, 0);
+	::vkCmdBindDescriptorSets(recorder.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->m_pipeline_layout, 0, 1, pipeline->get_descriptor_set(), 0, nullptr);
+	::vkCmdBindPipeline(recorder.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->get_graphics_pipeline());
+	::vkCmdPushConstants(recorder.m_command_buffer, pipeline->m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push_constants_t), &m_push_constants);
+
+	recorder.m_bound_pipeline = pipeline;
+}
+
+auto draw::renderer_t::draw_culled(const draw_command_t& command) -> void
+{
+	auto command_buffer = this->recorder().m_command_buffer;
+
+	// survivors were compacted into the cull buffer behind their indirect command
+	const auto& stream = m_culling->get_stream(command.m_stream);
+	::vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_culling->get_buffer(), &stream.m_output_offset);
+	::vkCmdDrawIndirect(command_buffer, m_culling->get_buffer(), stream.m_command_offset, 1, 0);
 }
 
 // MESH RENDERING
 auto draw::renderer_t::allocate_vertices(mesh_buffer_t& mesh_buffer) -> void
 {
-	auto vertices = std::vector<vertex_t>{};
+	this->upload(mesh_buffer.m_vertices);
+	this->upload(mesh_buffer.m_depths);
+
+	// opaque calls go first and front to back so the early depth test rejects what they cover, translucent calls follow in submission order
+	std::reverse(mesh_buffer.m_opaque.begin(), mesh_buffer.m_opaque.end());
 
-	for (const auto& mesh_info : mesh_buffer.m_info)
-		vertices.insert(vertices.end(), mesh_info.m_vertices.begin(), mesh_info.m_vertices.end());
+	auto indices = m_vertex_ring->allocate(sizeof(std::uint32_t) * mesh_buffer.m_indices.size());
+	auto index_data = static_cast<std::uint32_t*>(indices.m_data);
+	auto first_index = std::uint32_t{0};
 
-	if (auto new_size = sizeof(vertex_t) * vertices.size(); new_size != mesh_buffer.m_vertex_buffer.m_size)
+	for (auto draws : {&mesh_buffer.m_opaque, &mesh_buffer.m_draws})
 	{
-		mesh_buffer.m_vertex_buffer.m_size = new_size;
-		this->create_vertex_buffer(mesh_buffer.m_vertex_buffer);
+		for (auto& draw : *draws)
+		{
+			std::memcpy(index_data + first_index, mesh_buffer.m_indices.data() + draw.m_first_index, sizeof(std::uint32_t) * draw.m_index_count);
+			draw.m_first_index = first_index;
+			first_index += draw.m_index_count;
+		}
 	}
 
-	// copy data to buffer
-	void* data{nullptr};
-	::vkMapMemory(m_device->get_device(), mesh_buffer.m_vertex_buffer.m_memory, 0, mesh_buffer.m_vertex_buffer.m_size, 0, &data);
-	std::memcpy(data, vertices.data(), mesh_buffer.m_vertex_buffer.m_size);
-	::vkUnmapMemory(m_device->get_device(), mesh_buffer.m_vertex_buffer.m_memory);
+	mesh_buffer.m_index_offset = indices.m_offset;
+
+	// meshes are culled per call, the survivors are drawn through a gpu written draw count
+	if (m_gpu_culling && m_device->get_vulkan_12_features().drawIndirectCount)
+	{
+		auto draws = m_vertex_ring->allocate(sizeof(mesh_draw_t) * (mesh_buffer.m_opaque.size() + mesh_buffer.m_draws.size()));
+		std::memcpy(draws.m_data, mesh_buffer.m_opaque.data(), sizeof(mesh_draw_t) * mesh_buffer.m_opaque.size());
+		std::memcpy(static_cast<mesh_draw_t*>(draws.m_data) + mesh_buffer.m_opaque.size(), mesh_buffer.m_draws.data(), sizeof(mesh_draw_t) * mesh_buffer.m_draws.size());
+		mesh_buffer.m_draw_offset = draws.m_offset;
+	}
 }
 
-auto draw::renderer_t::render_vertices(mesh_buffer_t& mesh_buffer) -> void
+auto draw::renderer_t::cull_vertices(mesh_buffer_t& mesh_buffer, draw_command_t& command) -> void
 {
-	::vkCmdBindDescriptorSets(m_swap_chain->get_render_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_mesh_pipeline->m_pipeline_layout, 0, 1, m_mesh_pipeline->get_descriptor_set(), 0, nullptr);
-	::vkCmdBindVertexBuffers(m_swap_chain->get_render_buffer(), 0, 1, &mesh_buffer.m_vertex_buffer.m_buffer, &settings::vertex_buffer_offset);
-	::vkCmdBindPipeline(m_swap_chain->get_render_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_mesh_pipeline->get_graphics_pipeline());
-	
-	for (auto i = std::uint32_t{0}, drawn_vertices = std::uint32_t{0}; i < mesh_buffer.m_info.size(); i++)
+	if (!m_gpu_culling || !m_device->get_vulkan_12_features().drawIndirectCount)
+		return;
+
+	// translucent records were uploaded behind the opaque ones
+	auto first = command.m_kind == draw_kind::opaque_mesh ? command.m_first : static_cast<std::uint32_t>(mesh_buffer.m_opaque.size()) + command.m_first;
+	command.m_stream = m_culling->add_stream(cull_kind::mesh, mesh_buffer.m_draw_offset + sizeof(mesh_draw_t) * first, command.m_count, sizeof(mesh_draw_t), this->recorder().m_clip);
+}
+
+auto draw::renderer_t::render_vertices(mesh_buffer_t& mesh_buffer, const draw_command_t& command) -> void
+{
+	auto vertex_buffers = std::array<VkBuffer, 2>{m_vertex_ring->get_buffer(), m_vertex_ring->get_buffer()};
+	auto vertex_offsets = std::array<VkDeviceSize, 2>{mesh_buffer.m_vertices.m_offset, mesh_buffer.m_depths.m_offset};
+	auto command_buffer = this->recorder().m_command_buffer;
+
+	// only the opaque pre-pass writes depth
+	this->bind_pipeline(command.m_kind == draw_kind::opaque_mesh ? m_mesh_pipeline : m_translucent_mesh_pipeline);
+	::vkCmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers.data(), vertex_offsets.data());
+	::vkCmdBindIndexBuffer(command_buffer, m_vertex_ring->get_buffer(), mesh_buffer.m_index_offset, VK_INDEX_TYPE_UINT32);
+
+	if (command.m_stream != ~0u)
 	{
-		::vkCmdDraw(m_swap_chain->get_render_buffer(), mesh_buffer.m_info.at(i).m_vertices.size(), 1, drawn_vertices, 0);
-		drawn_vertices += mesh_buffer.m_info.at(i).m_vertices.size();
+		const auto& stream = m_culling->get_stream(command.m_stream);
+		::vkCmdDrawIndexedIndirectCount(command_buffer, m_culling->get_buffer(), stream.m_output_offset,
+			m_culling->get_buffer(), stream.m_command_offset, stream.m_count, sizeof(VkDrawIndexedIndirectCommand));
+		return;
 	}
+
+	// the calls of a command are contiguous in the index stream, a single draw covers them
+	const auto& draws = command.m_kind == draw_kind::opaque_mesh ? mesh_buffer.m_opaque : mesh_buffer.m_draws;
+	const auto& first = draws.at(command.m_first);
+	const auto& last = draws.at(command.m_first + command.m_count - 1);
+
+	::vkCmdDrawIndexed(command_buffer, last.m_first_index + last.m_index_count - first.m_first_index, 1, first.m_first_index, 0, 0);
 }
 
-// LINE RENDERING
-auto draw::renderer_t::allocate_vertices(line_buffer_t& line_buffer) -> void
+// RETAINED MESH RENDERING
+auto draw::renderer_t::register_mesh(const std::vector<vertex_t>& vertices, const std::vector<std::uint32_t>& indices) -> mesh_handle_t
 {
-	auto vertices = std::vector<vertex_t>{};
+	return m_mesh_pool->add(vertices, indices);
+}
 
-	for (const auto& line_info : line_buffer.m_info)
-		vertices.insert(vertices.end(), line_info.m_vertices.begin(), line_info.m_vertices.end());
+auto draw::renderer_t::allocate_vertices(retained_buffer_t& retained_buffer) -> void
+{
+	this->upload(retained_buffer.m_instances);
+}
+
+auto draw::renderer_t::render_vertices(retained_buffer_t& retained_buffer, const draw_command_t& command) -> void
+{
+	auto vertex_buffers = std::array<VkBuffer, 2>{m_mesh_pool->get_vertex_buffer(), m_vertex_ring->get_buffer()};
+	auto vertex_offsets = std::array<VkDeviceSize, 2>{0, retained_buffer.m_instances.m_offset};
+	auto command_buffer = this->recorder().m_command_buffer;
 
-	if (auto new_size = sizeof(vertex_t) * vertices.size(); new_size != line_buffer.m_vertex_buffer.m_size)
+	this->bind_pipeline(m_retained_pipeline);
+	::vkCmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers.data(), vertex_offsets.data());
+	::vkCmdBindIndexBuffer(command_buffer, m_mesh_pool->get_index_buffer(), 0, VK_INDEX_TYPE_UINT32);
+
+	// one instanced call per run of the same mesh, only the instances were uploaded this frame
+	for (auto i = command.m_first; i < command.m_first + command.m_count; i++)
 	{
-		line_buffer.m_vertex_buffer.m_size = new_size;
-		this->create_vertex_buffer(line_buffer.m_vertex_buffer);
+		const auto& draw = retained_buffer.m_draws.at(i);
+		const auto& mesh = m_mesh_pool->get_mesh(draw.m_mesh);
+		::vkCmdDrawIndexed(command_buffer, mesh.m_index_count, draw.m_instance_count, mesh.m_first_index, mesh.m_vertex_offset, draw.m_first_instance);
 	}
+}
 
-	// copy data to buffer
-	void* data{nullptr};
-	::vkMapMemory(m_device->get_device(), line_buffer.m_vertex_buffer.m_memory, 0, line_buffer.m_vertex_buffer.m_size, 0, &data);
-	std::memcpy(data, vertices.data(), line_buffer.m_vertex_buffer.m_size);
-	::vkUnmapMemory(m_device->get_device(), line_buffer.m_vertex_buffer.m_memory);
+// POLYGON RENDERING
+auto draw::renderer_t::allocate_vertices(polygon_buffer_t& polygon_buffer) -> void
+{
+	this->upload(polygon_buffer.m_vertices);
+	this->upload(polygon_buffer.m_indices);
+	this->upload(polygon_buffer.m_covers);
 }
 
-auto draw::renderer_t::render_vertices(line_buffer_t& line_buffer) -> void
+auto draw::renderer_t::render_vertices(polygon_buffer_t& polygon_buffer, const draw_command_t& command) -> void
 {
-	::vkCmdBindDescriptorSets(m_swap_chain->get_render_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_line_pipeline->m_pipeline_layout, 0, 1, m_line_pipeline->get_descriptor_set(), 0, nullptr);
-	::vkCmdBindVertexBuffers(m_swap_chain->get_render_buffer(), 0, 1, &line_buffer.m_vertex_buffer.m_buffer, &settings::vertex_buffer_offset);
-	::vkCmdBindPipeline(m_swap_chain->get_render_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_line_pipeline->get_graphics_pipeline());
+	auto command_buffer = this->recorder().m_command_buffer;
+	::vkCmdBindIndexBuffer(command_buffer, m_vertex_ring->get_buffer(), polygon_buffer.m_indices.m_offset, VK_INDEX_TYPE_UINT32);
 
-	for (auto i = std::uint32_t{0}, drawn_vertices = std::uint32_t{0}; i < line_buffer.m_info.size(); i++)
+	for (auto i = command.m_first; i < command.m_first + command.m_count; i++)
 	{
-		if (auto new_width = line_buffer.m_info.at(i).m_width; m_line_width != new_width)
-			::vkCmdSetLineWidth(m_swap_chain->get_render_buffer(), m_line_width = new_width);
-
-		::vkCmdDraw(m_swap_chain->get_render_buffer(), line_buffer.m_info.at(i).m_vertices.size(), 1, drawn_vertices, 0);
-		drawn_vertices += line_buffer.m_info.at(i).m_vertices.size();
+		const auto& draw = polygon_buffer.m_draws.at(i);
+
+		// accumulate the winding number of every pixel the fan touches
+		this->bind_pipeline(m_winding_pipeline);
+		::vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_vertex_ring->get_buffer(), &polygon_buffer.m_vertices.m_offset);
+		::vkCmdDrawIndexed(command_buffer, draw.m_index_count, 1, draw.m_first_index, 0, 0);
+
+		// fill where the winding number passes the fill rule, only the low bit matters for even odd
+		this->bind_pipeline(m_cover_pipeline);
+		::vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_vertex_ring->get_buffer(), &polygon_buffer.m_covers.m_offset);
+		::vkCmdSetStencilCompareMask(command_buffer, VK_STENCIL_FACE_FRONT_AND_BACK, draw.m_rule == fill_rule::even_odd ? 0x01 : 0xff);
+		::vkCmdDraw(command_buffer, 4, 1, 0, i);
 	}
 }
 
+// LINE RENDERING
+auto draw::renderer_t::allocate_vertices(line_buffer_t& line_buffer) -> void
+{
+	this->upload(line_buffer.m_lines);
+}
+
+auto draw::renderer_t::cull_vertices(line_buffer_t& line_buffer, draw_command_t& command) -> void
+{
+	this->cull_instances(cull_kind::line, line_buffer.m_lines, command);
+}
+
+auto draw::renderer_t::render_vertices(line_buffer_t& line_buffer, const draw_command_t& command) -> void
+{
+	// every segment of the command in a single call, widths and caps are expanded in line.vert
+	this->draw_instances(m_line_pipeline, line_buffer.m_lines, command);
+}
+
+// SHAPE RENDERING
+auto draw::renderer_t::allocate_vertices(shape_buffer_t& shape_buffer) -> void
+{
+	this->upload(shape_buffer.m_shapes);
+}
+
+auto draw::renderer_t::cull_vertices(shape_buffer_t& shape_buffer, draw_command_t& command) -> void
+{
+	this->cull_instances(cull_kind::shape, shape_buffer.m_shapes, command);
+}
+
+auto draw::renderer_t::render_vertices(shape_buffer_t& shape_buffer, const draw_command_t& command) -> void
+{
+	// one quad per shape, the outline is evaluated in shape.frag
+	this->draw_instances(m_shape_pipeline, shape_buffer.m_shapes, command);
+}
+
 // TEXT RENDERING
 auto draw::renderer_t::allocate_vertices(text_buffer_t& text_buffer) -> void
 {
-	auto vertices = std::vector<text_vertex_t>{};
+	this->upload(text_buffer.m_glyphs);
+}
 
-	for (const auto& text_info : text_buffer.m_info)
-		vertices.insert(vertices.end(), text_info.m_vertices.begin(), text_info.m_vertices.end());
+auto draw::renderer_t::cull_vertices(text_buffer_t& text_buffer, draw_command_t& command) -> void
+{
+	this->cull_instances(cull_kind::glyph, text_buffer.m_glyphs, command);
+}
 
-	if (auto new_size = sizeof(text_vertex_t) * vertices.size(); new_size != text_buffer.m_vertex_buffer.m_size)
+auto draw::renderer_t::render_vertices(text_buffer_t& text_buffer, const draw_command_t& command) -> void
+{
+	// every glyph of the command in a single call, the quad is expanded in text.vert
+	this->draw_instances(m_text_pipeline, text_buffer.m_glyphs, command);
+}
+
+// CACHED LAYER COMPOSITING
+auto draw::renderer_t::allocate_vertices(cached_buffer_t& cached_buffer) -> void
+{
+	this->upload(cached_buffer.m_instances);
+}
+
+auto draw::renderer_t::render_vertices(cached_buffer_t& cached_buffer, const draw_command_t& command) -> void
+{
+	auto command_buffer = this->recorder().m_command_buffer;
+	this->bind_pipeline(m_composite_pipeline);
+
+	// every layer is its own image, its set replaces the pipeline's placeholder
+	::vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_composite_pipeline->m_pipeline_layout, 0, 1,
+		m_layer_cache->get_descriptor_set(cached_buffer.m_targets.at(command.m_first)), 0, nullptr);
+
+	::vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_vertex_ring->get_buffer(), &cached_buffer.m_instances.m_offset);
+	::vkCmdDraw(command_buffer, 4, command.m_count, 0, command.m_first);
+}
+
+auto draw::renderer_t::create_cached_layer() -> std::uint32_t
+{
+	return m_layer_cache->create_layer();
+}
+
+auto draw::renderer_t::set_transform(const transform_t& transform) -> void
+{
+	m_transform = transform;
+	this->update_projection();
+}
+
+auto draw::renderer_t::to_clip_space(const std::array<std::float_t, 4>* clip) -> std::array<std::float_t, 4>
+{
+	if (!clip)
+		return {-1.0f, -1.0f, 1.0f, 1.0f};
+
+	// pixel rect through the transform, a rotated clip is bounded by its axis aligned box
+	auto clip_space = std::array<std::float_t, 4>{1.0f, 1.0f, -1.0f, -1.0f};
+	for (auto corner : {vec2_t{(*clip)[0], (*clip)[1]}, vec2_t{(*clip)[2], (*clip)[1]}, vec2_t{(*clip)[0], (*clip)[3]}, vec2_t{(*clip)[2], (*clip)[3]}})
 	{
-		text_buffer.m_vertex_buffer.m_size = new_size;
-		this->create_vertex_buffer(text_buffer.m_vertex_buffer);
+		auto x = std::clamp(m_push_constants.m_row_x[0] * corner.m_x + m_push_constants.m_row_x[1] * corner.m_y + m_push_constants.m_row_x[2], -1.0f, 1.0f);
+		auto y = std::clamp(m_push_constants.m_row_y[0] * corner.m_x + m_push_constants.m_row_y[1] * corner.m_y + m_push_constants.m_row_y[2], -1.0f, 1.0f);
+
+		clip_space = {std::min(clip_space[0], x), std::min(clip_space[1], y), std::max(clip_space[2], x), std::max(clip_space[3], y)};
 	}
 
-	// copy data to buffer
-	void* data{nullptr};
-	::vkMapMemory(m_device->get_device(), text_buffer.m_vertex_buffer.m_memory, 0, text_buffer.m_vertex_buffer.m_size, 0, &data);
-	std::memcpy(data, vertices.data(), text_buffer.m_vertex_buffer.m_size);
-	::vkUnmapMemory(m_device->get_device(), text_buffer.m_vertex_buffer.m_memory);
+	return clip_space;
+}
+
+auto draw::renderer_t::set_cull_clip(std::uint32_t id, const std::array<std::float_t, 4>* clip) -> void
+{
+	auto& recorder = this->recorder();
+	if (recorder.m_clip_id == id)
+		return;
+
+	recorder.m_clip = this->to_clip_space(clip);
+	recorder.m_clip_id = id;
 }
 
-auto draw::renderer_t::render_vertices(text_buffer_t& text_buffer) -> void
+auto draw::renderer_t::set_clip(std::uint32_t id, const std::array<std::float_t, 4>* clip) -> void
 {
-	::vkCmdBindDescriptorSets(m_swap_chain->get_render_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_text_pipeline->m_pipeline_layout, 0, 1, m_text_pipeline->get_descriptor_set(), 0, nullptr);
-	::vkCmdBindVertexBuffers(m_swap_chain->get_render_buffer(), 0, 1, &text_buffer.m_vertex_buffer.m_buffer, &settings::vertex_buffer_offset);
-	::vkCmdBindPipeline(m_swap_chain->get_render_buffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, m_text_pipeline->get_graphics_pipeline());
+	auto& recorder = this->recorder();
+	if (recorder.m_clip_id == id)
+		return;
 
-	for (auto drawn = std::uint32_t{0}; auto info : text_buffer.m_info)
+	const auto& clip_space = recorder.m_clip = this->to_clip_space(clip);
+	auto scissor = VkRect2D{VkOffset2D{0, 0}, m_render_extent};
+
+	if (clip)
 	{
-		for (auto letter = std::uint32_t{0}; letter != info.m_vertices.size() / 4; letter++)
-			::vkCmdDraw(m_swap_chain->get_render_buffer(), 4, 1, drawn + letter * 4, 0);
+		// clip space to framebuffer pixels, rounded outwards
+		auto left = static_cast<std::int32_t>(std::floor((clip_space[0] + 1.0f) * 0.5f * m_viewport.width));
+		auto top = static_cast<std::int32_t>(std::floor((clip_space[1] + 1.0f) * 0.5f * m_viewport.height));
+		auto right = static_cast<std::int32_t>(std::ceil((clip_space[2] + 1.0f) * 0.5f * m_viewport.width));
+		auto bottom = static_cast<std::int32_t>(std::ceil((clip_space[3] + 1.0f) * 0.5f * m_viewport.height));
 
-		drawn += info.m_vertices.size();
+		scissor = VkRect2D{VkOffset2D{left, top}, VkExtent2D{static_cast<std::uint32_t>(std::max(right - left, 0)), static_cast<std::uint32_t>(std::max(bottom - top, 0))}};
 	}
+
+	::vkCmdSetScissor(recorder.m_command_buffer, 0, 1, &scissor);
+	recorder.m_clip_id = id;
 }
 
+auto draw::renderer_t::set_gpu_culling(bool enabled) -> void
+{
+	m_gpu_culling = enabled;
+}
 
-auto draw::renderer_t::begin_frame() -> void
+auto draw::renderer_t::set_present_mode(present_mode mode) -> void
 {
-	m_swap_chain->acquire_next_image();
+	m_recreate |= mode != m_present_mode;
+	m_present_mode = mode;
+}
+
+auto draw::renderer_t::get_present_mode() -> present_mode
+{
+	return m_swap_chain->get_present_mode();
+}
+
+auto draw::renderer_t::set_extent(VkExtent2D extent) -> void
+{
+	if (!extent.width || !extent.height)
+		return;
+
+	m_recreate |= extent.width != m_requested_extent.width || extent.height != m_requested_extent.height;
+	m_requested_extent = extent;
+}
+
+auto draw::renderer_t::get_extent() -> const VkExtent2D
+{
+	return m_extent;
+}
+
+auto draw::renderer_t::set_dynamic_resolution(bool enabled) -> void
+{
+	m_recreate |= enabled != m_offscreen.m_enabled;
+	m_offscreen.m_enabled = enabled;
+}
+
+auto draw::renderer_t::get_render_scale() -> std::float_t
+{
+	return m_offscreen.m_view ? m_offscreen.m_scale : 1.0f;
+}
+
+auto draw::renderer_t::prepare_frame() -> bool
+{
+	// resized, switched modes or reported stale by the last present, rebuilt before the scene records
+	if (m_recreate || m_swap_chain->get_out_of_date())
+		this->recreate_targets();
+
+	// the slot's last frame is done, its timestamps are available
+	m_swap_chain->wait_frame();
+
+	if (m_offscreen.m_view)
+		this->update_render_scale();
+
+	return std::exchange(m_targets_lost, false);
+}
+
+auto draw::renderer_t::begin_frame() -> bool
+{
+	// recreating here would wipe layers the scene already composites as clean, the next prepare_frame rebuilds and reports them lost
+	if (!m_swap_chain->acquire_next_image())
+		return false;
+
+	m_vertex_ring->begin_frame(m_swap_chain->get_frame_index());
+	m_culling->begin_frame(m_swap_chain->get_frame_index());
+
+	// the slot's secondary buffers finished executing with its last frame
+	for (auto& recorder : m_recorders)
+	{
+		vk_check_result(::vkResetCommandPool(m_device->get_device(), recorder.m_command_pools.at(m_swap_chain->get_frame_index()), 0));
+		recorder.m_used = 0;
+	}
+
+	// the calling thread records culling and inline passes into the primary buffer
+	m_recorders.front().m_command_buffer = m_swap_chain->get_render_buffer();
+	m_recorders.front().m_clip_id = ~0u;
 	
 	::vkBeginCommandBuffer(m_swap_chain->get_render_buffer(), &m_render_command_buffer_bi);
-	::vkCmdSetViewport(m_swap_chain->get_render_buffer(), 0, 1, &settings::viewport);
 
-	m_render_pass_bi.framebuffer = m_frame_buffers.at(m_swap_chain->get_buffer_index());
-	::vkCmdBeginRenderPass(m_swap_chain->get_render_buffer(), &m_render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+	if (m_offscreen.m_view)
+	{
+		auto first_query = m_swap_chain->get_frame_index() * 2;
+		::vkCmdResetQueryPool(m_swap_chain->get_render_buffer(), m_offscreen.m_query_pool, first_query, 2);
+		::vkCmdWriteTimestamp(m_swap_chain->get_render_buffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_offscreen.m_query_pool, first_query);
+	}
+
+	return true;
 }
 
-auto draw::renderer_t::end_frame() -> void
+auto draw::renderer_t::acquire_uploads() -> void
+{
+	// everything uploaded so far is submitted, ownership transfers are recorded ahead of the work reading it
+	m_upload_value = m_uploader->acquire(m_swap_chain->get_render_buffer());
+}
+
+auto draw::renderer_t::cull() -> void
+{
+	// compute work has to be recorded before the render pass begins
+	if (m_gpu_culling)
+		m_culling->dispatch(m_swap_chain->get_render_buffer(), m_vertex_ring->get_buffer(), m_push_constants);
+}
+
+auto draw::renderer_t::begin_pass(std::uint32_t target, VkSubpassContents contents) -> const VkRenderPassBeginInfo&
+{
+	// cached layers are redrawn into their own image ahead of the swap chain pass
+	if (target == settings::sort_key::screen_target)
+	{
+		// under dynamic resolution the screen is drawn offscreen and blitted at the end of the frame
+		m_render_pass_bi.renderPass = m_offscreen.m_view ? m_offscreen.m_render_pass : m_render_pass;
+		m_render_pass_bi.framebuffer = m_offscreen.m_view ? m_offscreen.m_frame_buffer : m_frame_buffers.at(m_swap_chain->get_buffer_index());
+		::vkCmdBeginRenderPass(m_swap_chain->get_render_buffer(), &m_render_pass_bi, contents);
+		return m_render_pass_bi;
+	}
+
+	m_layer_pass_bi.framebuffer = m_layer_cache->get_frame_buffer(target);
+	::vkCmdBeginRenderPass(m_swap_chain->get_render_buffer(), &m_layer_pass_bi, contents);
+	return m_layer_pass_bi;
+}
+
+auto draw::renderer_t::end_pass() -> void
 {
 	::vkCmdEndRenderPass(m_swap_chain->get_render_buffer());
+}
+
+auto draw::renderer_t::record_pass(std::uint32_t target, std::span<draw_command_t> commands, const std::function<void(draw_command_t&)>& record) -> void
+{
+	auto chunks = static_cast<std::uint32_t>(std::min<std::size_t>(m_recorders.size(), commands.size() / settings::recording::min_commands));
+
+	// handing out a few hundred commands costs more than recording them
+	if (chunks < 2)
+	{
+		this->begin_pass(target, VK_SUBPASS_CONTENTS_INLINE);
+		this->begin_recording(m_recorders.front());
+
+		for (auto& command : commands)
+			record(command);
+
+		this->end_pass();
+		return;
+	}
+
+	// workers would race on a pipeline compiled on first bind
+	if (settings::startup::lazy_pipelines)
+		for (auto pipeline : {m_mesh_pipeline, m_translucent_mesh_pipeline, m_retained_pipeline, m_winding_pipeline, m_cover_pipeline, m_line_pipeline, m_shape_pipeline, m_text_pipeline, m_composite_pipeline})
+			pipeline->get_graphics_pipeline();
+
+	const auto& pass_bi = this->begin_pass(target, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	auto inheritance_info = init::command_buffer_inheritance_info(pass_bi.renderPass, pass_bi.framebuffer);
+	auto command_buffer_bi = init::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &inheritance_info);
+
+	// contiguous runs keep the sort order once the buffers are executed one after another
+	m_pass_buffers.resize(chunks);
+	m_thread_pool->run(chunks, [&](std::uint32_t chunk, std::uint32_t worker) {
+		s_recorder = worker;
+
+		auto& recorder = m_recorders.at(worker);
+		recorder.m_command_buffer = this->secondary_buffer(recorder);
+
+		::vkBeginCommandBuffer(recorder.m_command_buffer, &command_buffer_bi);
+		this->begin_recording(recorder);
+
+		for (auto i = commands.size() * chunk / chunks; i < commands.size() * (chunk + 1) / chunks; i++)
+			record(commands[i]);
+
+		vk_check_result(::vkEndCommandBuffer(recorder.m_command_buffer));
+		m_pass_buffers.at(chunk) = recorder.m_command_buffer;
+	});
+
+	m_recorders.front().m_command_buffer = m_swap_chain->get_render_buffer();
+
+	::vkCmdExecuteCommands(m_swap_chain->get_render_buffer(), chunks, m_pass_buffers.data());
+	this->end_pass();
+}
+
+auto draw::renderer_t::end_frame(const std::vector<VkRectLayerKHR>& damage) -> void
+{
+	if (m_offscreen.m_view)
+	{
+		this->blit_offscreen();
+
+		::vkCmdWriteTimestamp(m_swap_chain->get_render_buffer(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_offscreen.m_query_pool, m_swap_chain->get_frame_index() * 2 + 1);
+		m_offscreen.m_timed.at(m_swap_chain->get_frame_index()) = true;
+	}
+
 	::vkEndCommandBuffer(m_swap_chain->get_render_buffer());
 
-	m_swap_chain->queue_submit(m_device->get_graphics_queue());
-	m_swap_chain->queue_present(m_device->get_graphics_queue());
+	m_swap_chain->queue_submit(m_device->get_graphics_queue(), m_uploader->get_semaphore(), m_upload_value);
+	m_swap_chain->queue_present(m_device->get_graphics_queue(), damage);
+
+	if (settings::startup::report && m_created != std::chrono::steady_clock::time_point{})
+	{
+		auto time_to_frame = std::chrono::duration<std::float_t, std::milli>(std::chrono::steady_clock::now() - m_created).count();
+		std::cout << "first frame presented " << time_to_frame << " ms after the renderer was created" << std::endl;
+
+		m_created = std::chrono::steady_clock::time_point{};
+	}
 }
\ No newline at end of file
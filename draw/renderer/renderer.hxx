@@ -2,13 +2,26 @@
 
 #define VK_USE_PLATFORM_WIN32_KHR
 
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
 #include <memory>
+#include <span>
+#include <unordered_map>
 #include <windows.h>
 #include <vulkan/vulkan.h>
 
 #include "../device/device.hxx"
 #include "../pipeline/pipeline.hxx"
 #include "../swap_chain/swap_chain.hxx"
+#include "../ring_buffer/ring_buffer.hxx"
+#include "../mesh_pool/mesh_pool.hxx"
+#include "../culling/culling.hxx"
+#include "../layer_cache/layer_cache.hxx"
+#include "../uploader/uploader.hxx"
+#include "../task_graph/task_graph.hxx"
+#include "../thread_pool/thread_pool.hxx"
 #include "../utils/containers.hxx"
 
 namespace draw
@@ -17,28 +30,92 @@ namespace draw
 	{
 		device_t* m_device{nullptr};
 		swap_chain_t* m_swap_chain{nullptr};
+		uploader_t* m_uploader{nullptr};
+		std::uint64_t m_upload_value{0}; // timeline value the frame's submit waits on
 
 		VkRenderPass m_render_pass{nullptr};
 		VkPipelineCache m_pipeline_cache{nullptr};
+		std::unordered_map<const std::uint32_t*, VkShaderModule> m_shader_modules{}; // keyed by the embedded spir-v
 		std::vector<VkFramebuffer> m_frame_buffers{ };
 
 		struct {
 			VkImage m_image{nullptr};
-			VkDeviceMemory m_memory{nullptr};
+			memory_allocation_t m_allocation{ };
 			VkImageView m_view{nullptr};
 		} m_depth_stencil{ };
 
+		// dynamic resolution, the screen pass draws into the corner of an image blitted up to the swap chain
+		struct {
+			bool m_enabled{settings::resolution::dynamic};
+			std::float_t m_scale{1.0f}; // of the swap chain extent
+			std::float_t m_gpu_time{settings::resolution::target_time}; // smoothed, in milliseconds
+
+			VkQueryPool m_query_pool{nullptr}; // begin and end timestamp per frame in flight
+			std::vector<bool> m_timed{}; // the frame's queries were written
+			std::float_t m_timestamp_period{0.0f}; // nanoseconds per tick, 0 without timestamp support
+
+			VkRenderPass m_render_pass{nullptr}; // compatible with m_render_pass, left ready to be blitted
+			VkImage m_image{nullptr};
+			memory_allocation_t m_allocation{ };
+			VkImageView m_view{nullptr};
+			VkFramebuffer m_frame_buffer{nullptr};
+		} m_offscreen{ };
+
 		pipeline_t* m_mesh_pipeline{nullptr};
+		pipeline_t* m_translucent_mesh_pipeline{nullptr};
+		pipeline_t* m_retained_pipeline{nullptr};
+		pipeline_t* m_winding_pipeline{nullptr};
+		pipeline_t* m_cover_pipeline{nullptr};
 		pipeline_t* m_line_pipeline{nullptr};
+		pipeline_t* m_shape_pipeline{nullptr};
 		pipeline_t* m_text_pipeline{nullptr};
+		pipeline_t* m_composite_pipeline{nullptr};
 
 		std::vector<VkPipeline> m_pipelines{};
 
+		ring_buffer_t* m_vertex_ring{nullptr};
+		mesh_pool_t* m_mesh_pool{nullptr};
+
+		culling_t* m_culling{nullptr};
+		bool m_gpu_culling{false};
+
+		present_mode m_present_mode{settings::present::mode}; // requested, the swap chain may have fallen back
+		VkExtent2D m_requested_extent{window::res_vk}; // window client area
+		VkExtent2D m_extent{window::res_vk}; // of the swap chain, pixel coordinates map onto it
+		VkExtent2D m_render_extent{window::res_vk}; // drawn to, scaled down under dynamic resolution
+		VkViewport m_viewport{};
+		bool m_recreate{false}; // targets are rebuilt before the next acquire
+		bool m_targets_lost{false}; // cached layer content has to be redrawn
+
+		layer_cache_t* m_layer_cache{nullptr};
+
+		// recording state of one thread, 0 is the calling thread and records inline passes into the frame's primary buffer
+		struct recorder_t {
+			VkCommandBuffer m_command_buffer{nullptr}; // being recorded into
+			pipeline_t* m_bound_pipeline{nullptr}; // inside the current render pass
+			std::uint32_t m_clip_id{~0u}; // last clip set, the scene's index + 1
+			std::array<std::float_t, 4> m_clip{-1.0f, -1.0f, 1.0f, 1.0f}; // clip space, handed to culled streams
+
+			std::vector<VkCommandPool> m_command_pools{}; // per frame in flight, reset as a whole
+			std::vector<std::vector<VkCommandBuffer>> m_secondary_buffers{}; // per frame in flight, allocated on first use
+			std::uint32_t m_used{0}; // secondary buffers taken this frame
+		};
+
+		thread_pool_t* m_thread_pool{nullptr};
+		std::vector<recorder_t> m_recorders{};
+		std::vector<VkCommandBuffer> m_pass_buffers{}; // secondary buffers of the pass being split, executed in command order
+		static thread_local std::uint32_t s_recorder; // of the calling thread
+
 		std::array<VkClearValue, 2> m_clear_values{};
+		std::array<VkClearValue, 2> m_layer_clear_values{};
 		VkCommandBufferBeginInfo m_render_command_buffer_bi{};
 		VkRenderPassBeginInfo m_render_pass_bi{};
+		VkRenderPassBeginInfo m_layer_pass_bi{};
+
+		transform_t m_transform{};
+		push_constants_t m_push_constants{};
 
-		std::float_t m_line_width{1.0f};
+		std::chrono::steady_clock::time_point m_created{std::chrono::steady_clock::now()}; // reset once the first frame was presented
 
 	public:
 
@@ -48,29 +125,165 @@ namespace draw
 
 	private:
 
+		auto pipeline_cache_header(std::uint64_t size) -> pipeline_cache_header_t;
+
+		auto pipeline_cache_path() -> std::filesystem::path;
+
+		auto create_pipeline_cache() -> void;
+
+		auto save_pipeline_cache() -> void;
+
+		auto create_shader_modules() -> void;
+
+		auto get_shader_module(std::span<const std::uint32_t> code) -> VkShaderModule;
+
+		auto get_shader_modules(const pipeline_setting_t& setting) -> shader_modules_t;
+
 		auto setup_depth_stencil() -> void;
 
+		auto create_offscreen() -> void;
+
+		auto destroy_targets() -> void;
+
+		auto recreate_targets() -> void;
+
+		auto update_render_extent() -> void;
+
+		auto update_render_scale() -> void;
+
+		auto blit_offscreen() -> void;
+
+		auto rasterize_font(stb_fontchar* font_data) -> std::vector<std::uint8_t>;
+
 		auto create_render_pass() -> void;
 
 		auto create_frame_buffers() -> void;
 
 		auto prepare_render_pass() -> void;
 
-		auto create_vertex_buffer(memory_buffer_t& vertex_buffer) -> void;
+		auto update_projection() -> void;
+
+		auto to_clip_space(const std::array<std::float_t, 4>* clip) -> std::array<std::float_t, 4>;
+
+		auto create_recorders() -> void;
+
+		auto recorder() -> recorder_t&;
+
+		// from the recorder's pool of the current frame
+		auto secondary_buffer(recorder_t& recorder) -> VkCommandBuffer;
+
+		// dynamic state isn't inherited, every command buffer of a pass starts from the whole target
+		auto begin_recording(recorder_t& recorder) -> void;
+
+		auto begin_pass(std::uint32_t target, VkSubpassContents contents) -> const VkRenderPassBeginInfo&;
+
+		auto end_pass() -> void;
+
+		auto bind_pipeline(pipeline_t* pipeline) -> void;
+
+		auto draw_culled(const draw_command_t& command) -> void;
+
+		template<typename T>
+		auto upload(batch_t<T>& batch) -> void
+		{
+			auto allocation = m_vertex_ring->allocate(sizeof(T) * batch.m_data.size());
+			std::memcpy(allocation.m_data, batch.m_data.data(), sizeof(T) * batch.m_data.size());
+			batch.m_offset = allocation.m_offset;
+		}
+
+		template<typename T>
+		auto cull_instances(cull_kind kind, const batch_t<T>& batch, draw_command_t& command) -> void
+		{
+			if (m_gpu_culling)
+				command.m_stream = m_culling->add_stream(kind, batch.m_offset + sizeof(T) * command.m_first, command.m_count, sizeof(T), this->recorder().m_clip);
+		}
+
+		// one quad per instance, expanded in the vertex shader
+		template<typename T>
+		auto draw_instances(pipeline_t* pipeline, const batch_t<T>& batch, const draw_command_t& command) -> void
+		{
+			this->bind_pipeline(pipeline);
+
+			if (command.m_stream != ~0u)
+			{
+				this->draw_culled(command);
+				return;
+			}
+
+			// every instance of the command in a single call
+			auto command_buffer = this->recorder().m_command_buffer;
+			::vkCmdBindVertexBuffers(command_buffer, 0, 1, &m_vertex_ring->get_buffer(), &batch.m_offset);
+			::vkCmdDraw(command_buffer, 4, command.m_count, 0, command.m_first);
+		}
 
 	public:
 		
 		auto allocate_vertices(mesh_buffer_t& mesh_buffer) -> void;
-		auto render_vertices(mesh_buffer_t& mesh_buffer) -> void;
+		auto cull_vertices(mesh_buffer_t& mesh_buffer, draw_command_t& command) -> void;
+		auto render_vertices(mesh_buffer_t& mesh_buffer, const draw_command_t& command) -> void;
+
+		auto register_mesh(const std::vector<vertex_t>& vertices, const std::vector<std::uint32_t>& indices) -> mesh_handle_t;
+
+		auto allocate_vertices(retained_buffer_t& retained_buffer) -> void;
+		auto render_vertices(retained_buffer_t& retained_buffer, const draw_command_t& command) -> void;
+
+		auto allocate_vertices(polygon_buffer_t& polygon_buffer) -> void;
+		auto render_vertices(polygon_buffer_t& polygon_buffer, const draw_command_t& command) -> void;
 
 		auto allocate_vertices(line_buffer_t& line_buffer) -> void;
-		auto render_vertices(line_buffer_t& line_buffer) -> void;
+		auto cull_vertices(line_buffer_t& line_buffer, draw_command_t& command) -> void;
+		auto render_vertices(line_buffer_t& line_buffer, const draw_command_t& command) -> void;
+
+		auto allocate_vertices(shape_buffer_t& shape_buffer) -> void;
+		auto cull_vertices(shape_buffer_t& shape_buffer, draw_command_t& command) -> void;
+		auto render_vertices(shape_buffer_t& shape_buffer, const draw_command_t& command) -> void;
 
 		auto allocate_vertices(text_buffer_t& text_buffer) -> void;
-		auto render_vertices(text_buffer_t& text_buffer) -> void;
+		auto cull_vertices(text_buffer_t& text_buffer, draw_command_t& command) -> void;
+		auto render_vertices(text_buffer_t& text_buffer, const draw_command_t& command) -> void;
+
+		auto allocate_vertices(cached_buffer_t& cached_buffer) -> void;
+		auto render_vertices(cached_buffer_t& cached_buffer, const draw_command_t& command) -> void;
+
+		auto create_cached_layer() -> std::uint32_t;
+
+		auto set_transform(const transform_t& transform) -> void;
+
+		// neighbouring commands mostly share a clip, the scissor only changes with the id
+		auto set_clip(std::uint32_t id, const std::array<std::float_t, 4>* clip = nullptr) -> void;
+
+		// clip space handed to culled streams, recorded outside the render pass without a scissor
+		auto set_cull_clip(std::uint32_t id, const std::array<std::float_t, 4>* clip = nullptr) -> void;
+
+		auto set_gpu_culling(bool enabled) -> void;
+
+		auto set_present_mode(present_mode mode) -> void;
+
+		auto get_present_mode() -> present_mode;
+
+		// applied before the next acquire, a zero extent (minimized) is ignored
+		auto set_extent(VkExtent2D extent) -> void;
+
+		auto get_extent() -> const VkExtent2D;
+
+		auto set_dynamic_resolution(bool enabled) -> void;
+
+		auto get_render_scale() -> std::float_t;
+
+		// before anything is drawn, true when the targets were recreated or rescaled and cached layers have to be redrawn
+		auto prepare_frame() -> bool;
+
+		// only once the frame is known to differ from the last presented one, false when it has to be dropped for a stale swap chain
+		auto begin_frame() -> bool;
+
+		auto acquire_uploads() -> void;
+
+		auto cull() -> void;
 
-		auto begin_frame() -> void;
+		// large passes are split into secondary command buffers recorded side by side, record is called concurrently then
+		auto record_pass(std::uint32_t target, std::span<draw_command_t> commands, const std::function<void(draw_command_t&)>& record) -> void;
 
-		auto end_frame() -> void;
+		// damage in swap chain pixels, empty for the whole image
+		auto end_frame(const std::vector<VkRectLayerKHR>& damage = {}) -> void;
 	};
 }
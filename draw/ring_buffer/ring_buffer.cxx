@@ -0,0 +1,99 @@
+#include "ring_buffer.hxx"
+
+#include <cstring>
+
+#include "../utils/error.hxx"
+#include "../utils/settings.hxx"
+#include "../utils/init.hxx"
+
+draw::ring_buffer_t::ring_buffer_t(device_t* device, VkBufferUsageFlags usage, std::uint32_t frame_count)
+	: m_device{device},
+	m_usage{usage},
+	m_frame_count{frame_count}
+{
+	this->create_buffer(settings::ring::min_size);
+}
+
+draw::ring_buffer_t::~ring_buffer_t()
+{
+	this->destroy_buffer();
+}
+
+auto draw::ring_buffer_t::create_buffer(VkDeviceSize region_size) -> void
+{
+	m_region_size = region_size;
+	m_buffer.m_size = m_region_size * m_frame_count;
+
+	auto buffer_ci = init::buffer_create_info(m_buffer.m_size, m_usage);
+	vk_check_result(::vkCreateBuffer(m_device->get_device(), &buffer_ci, nullptr, &m_buffer.m_buffer));
+
+	// host visible blocks stay mapped for their lifetime
+	m_buffer.m_allocation = m_device->allocate_buffer_memory(m_buffer.m_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	m_mapped = static_cast<std::uint8_t*>(m_buffer.m_allocation.m_mapped);
+}
+
+auto draw::ring_buffer_t::destroy_buffer() -> void
+{
+	if (m_buffer.m_buffer) ::vkDestroyBuffer(m_device->get_device(), m_buffer.m_buffer, nullptr);
+	if (m_buffer.m_allocation.m_memory) m_device->free_memory(m_buffer.m_allocation);
+
+	m_buffer = memory_buffer_t{};
+	m_mapped = nullptr;
+}
+
+auto draw::ring_buffer_t::resize(VkDeviceSize region_size) -> void
+{
+	// regions of other frames may still be read by the gpu
+	vk_check_result(::vkDeviceWaitIdle(m_device->get_device()));
+
+	// keep what the current frame already wrote, offsets handed out stay valid
+	auto frame_data = std::vector<std::uint8_t>(m_mapped + m_frame_index * m_region_size, m_mapped + m_frame_index * m_region_size + m_head);
+
+	this->destroy_buffer();
+	this->create_buffer(region_size);
+
+	std::memcpy(m_mapped + m_frame_index * m_region_size, frame_data.data(), frame_data.size());
+}
+
+auto draw::ring_buffer_t::begin_frame(std::uint32_t frame_index) -> void
+{
+	// shrink only after the region stayed mostly unused for a while, so a single
+	// quiet frame doesn't trigger a reallocation that the next busy one reverts
+	if (m_region_size > settings::ring::min_size && m_head * settings::ring::shrink_ratio < m_region_size)
+	{
+		if (++m_idle_frames >= settings::ring::shrink_frames)
+		{
+			m_head = 0;
+			m_idle_frames = 0;
+			this->resize(m_region_size / 2);
+		}
+	}
+	else m_idle_frames = 0;
+
+	m_frame_index = frame_index % m_frame_count;
+	m_head = 0;
+}
+
+auto draw::ring_buffer_t::allocate(VkDeviceSize size) -> ring_allocation_t
+{
+	auto offset = (m_head + settings::ring::alignment - 1) & ~(settings::ring::alignment - 1);
+
+	// grow geometrically, the frame data written so far is carried over
+	if (offset + size > m_region_size)
+	{
+		auto region_size = m_region_size * 2;
+		for (; offset + size > region_size; ) region_size *= 2;
+
+		this->resize(region_size);
+	}
+
+	m_head = offset + size;
+
+	auto base = m_frame_index * m_region_size + offset;
+	return ring_allocation_t{base, m_mapped + base};
+}
+
+auto draw::ring_buffer_t::get_buffer() -> const VkBuffer&
+{
+	return m_buffer.m_buffer;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "../device/device.hxx"
+#include "../utils/containers.hxx"
+
+namespace draw
+{
+	// persistently mapped host visible buffer, split in one region per frame
+	class ring_buffer_t
+	{
+		device_t* m_device{nullptr};
+
+		memory_buffer_t m_buffer{};
+		std::uint8_t* m_mapped{nullptr};
+		VkBufferUsageFlags m_usage{0};
+
+		std::uint32_t m_frame_count{1};
+		std::uint32_t m_frame_index{0};
+
+		VkDeviceSize m_region_size{0}; // bytes available to a single frame
+		VkDeviceSize m_head{0}; // bytes used by the current frame
+		std::uint32_t m_idle_frames{0}; // frames in a row spent under the shrink threshold
+
+	public:
+
+		ring_buffer_t(device_t* device, VkBufferUsageFlags usage, std::uint32_t frame_count);
+
+		~ring_buffer_t();
+
+	private:
+
+		auto create_buffer(VkDeviceSize region_size) -> void;
+
+		auto destroy_buffer() -> void;
+
+		auto resize(VkDeviceSize region_size) -> void;
+
+	public:
+
+		auto begin_frame(std::uint32_t frame_index) -> void;
+
+		auto allocate(VkDeviceSize size) -> ring_allocation_t;
+
+		auto get_buffer() -> const VkBuffer&;
+	};
+}
@@ -1,5 +1,8 @@
 #include "scene.hxx"
 
+#include <algorithm>
+#include <cfloat>
+
 #include "../utils/settings.hxx"
 #include "../utils/constants.hxx"
 #include "../../input/input.hxx"
@@ -15,22 +18,409 @@ draw::scene_t::~scene_t()
 	if (m_renderer) delete m_renderer;
 }
 
+auto draw::scene_t::next_depth() -> std::float_t
+{
+	// layers are stacked and later primitives of a layer are closer, opaque ones can be drawn in any order and still cover what's below
+	auto index = std::min(++m_layer_depths[m_layer], settings::depth::layer_primitives - 1);
+	return 1.0f - (m_layer * settings::depth::layer_primitives + index) * settings::depth::step;
+}
+
+auto draw::scene_t::make_key(draw_kind kind, std::uint8_t texture, std::uint8_t state) -> std::uint64_t
+{
+	return
+		static_cast<std::uint64_t>(m_target) << settings::sort_key::target_shift |
+		static_cast<std::uint64_t>(m_layer) << settings::sort_key::layer_shift |
+		static_cast<std::uint64_t>(this->clip_id()) << settings::sort_key::clip_shift |
+		static_cast<std::uint64_t>(kind) << settings::sort_key::kind_shift |
+		static_cast<std::uint64_t>(texture) << settings::sort_key::texture_shift |
+		static_cast<std::uint64_t>(state) << settings::sort_key::state_shift;
+}
+
+auto draw::scene_t::clip_id() -> std::uint32_t
+{
+	return m_clip_stack.empty() ? 0 : m_clip_stack.back();
+}
+
+auto draw::scene_t::rejected(const std::array<std::float_t, 4>& bounds) -> bool
+{
+	// trivial rejection, primitives entirely outside the active clip are never built or uploaded
+	auto visible = bounds;
+	if (auto id = this->clip_id())
+	{
+		const auto& clip = m_clips[id - 1];
+		if (bounds[0] > clip[2] || bounds[1] > clip[3] || bounds[2] < clip[0] || bounds[3] < clip[1])
+			return true;
+
+		visible = {std::max(bounds[0], clip[0]), std::max(bounds[1], clip[1]), std::min(bounds[2], clip[2]), std::min(bounds[3], clip[3])};
+	}
+
+	// parts of one primitive, e.g. glyphs of a text, share the digest of its inputs
+	this->damage(visible, m_damage.m_primitive);
+	m_damage.m_open = false;
+
+	if (m_recording == ~0u)
+		return false;
+
+	// the composite quad only covers what was drawn
+	m_recorded_bounds = {
+		std::min(m_recorded_bounds[0], visible[0]),
+		std::min(m_recorded_bounds[1], visible[1]),
+		std::max(m_recorded_bounds[2], visible[2]),
+		std::max(m_recorded_bounds[3], visible[3])
+	};
+
+	return false;
+}
+
+auto draw::scene_t::mark() -> scene_mark_t
+{
+	return scene_mark_t{
+		m_commands.size(),
+		m_meshes.m_vertices.m_data.size(),
+		m_meshes.m_depths.m_data.size(),
+		m_meshes.m_indices.size(),
+		m_meshes.m_opaque.size(),
+		m_meshes.m_draws.size(),
+		m_retained.m_instances.m_data.size(),
+		m_retained.m_draws.size(),
+		m_polygons.m_vertices.m_data.size(),
+		m_polygons.m_indices.m_data.size(),
+		m_polygons.m_covers.m_data.size(),
+		m_polygons.m_draws.size(),
+		m_lines.m_lines.m_data.size(),
+		m_shapes.m_shapes.m_data.size(),
+		m_text.m_glyphs.m_data.size(),
+		m_layer_depths
+	};
+}
+
+auto draw::scene_t::rewind(const scene_mark_t& mark) -> void
+{
+	m_commands.resize(mark.m_commands);
+
+	m_meshes.m_vertices.m_data.resize(mark.m_mesh_vertices);
+	m_meshes.m_depths.m_data.resize(mark.m_mesh_depths);
+	m_meshes.m_indices.resize(mark.m_mesh_indices);
+	m_meshes.m_opaque.resize(mark.m_mesh_opaque);
+	m_meshes.m_draws.resize(mark.m_mesh_draws);
+
+	m_retained.m_instances.m_data.resize(mark.m_retained_instances);
+	m_retained.m_draws.resize(mark.m_retained_draws);
+
+	m_polygons.m_vertices.m_data.resize(mark.m_polygon_vertices);
+	m_polygons.m_indices.m_data.resize(mark.m_polygon_indices);
+	m_polygons.m_covers.m_data.resize(mark.m_polygon_covers);
+	m_polygons.m_draws.resize(mark.m_polygon_draws);
+
+	m_lines.m_lines.m_data.resize(mark.m_lines);
+	m_shapes.m_shapes.m_data.resize(mark.m_shapes);
+	m_text.m_glyphs.m_data.resize(mark.m_glyphs);
+
+	m_layer_depths = mark.m_layer_depths;
+}
+
+auto draw::scene_t::digest_bytes(const void* data, std::size_t size) -> void
+{
+	// fnv-1a over the inputs of a primitive, cheaper than building what they describe
+	if (!m_damage.m_open)
+	{
+		m_damage.m_primitive = std::uint64_t{0xcbf29ce484222325};
+		m_damage.m_open = true;
+	}
+
+	auto bytes = static_cast<const std::uint8_t*>(data);
+	for (auto i = std::size_t{0}; i < size; i++)
+		m_damage.m_primitive = (m_damage.m_primitive ^ bytes[i]) * std::uint64_t{0x100000001b3};
+
+	// and over everything recorded into a cached layer
+	if (m_recording == ~0u)
+		return;
+
+	for (auto i = std::size_t{0}; i < size; i++)
+		m_digest = (m_digest ^ bytes[i]) * std::uint64_t{0x100000001b3};
+}
+
+auto draw::scene_t::damage(const std::array<std::float_t, 4>& bounds, std::uint64_t value) -> void
+{
+	if (bounds[0] > bounds[2] || bounds[1] > bounds[3])
+		return;
+
+	// pixel bounds through the transform, bounded by the axis aligned box of the corners
+	auto box = std::array<std::float_t, 4>{FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+	for (auto corner : {vec2_t{bounds[0], bounds[1]}, vec2_t{bounds[2], bounds[1]}, vec2_t{bounds[0], bounds[3]}, vec2_t{bounds[2], bounds[3]}})
+	{
+		auto x = m_transform.m_a * corner.m_x + m_transform.m_b * corner.m_y + m_transform.m_translation.m_x;
+		auto y = m_transform.m_c * corner.m_x + m_transform.m_d * corner.m_y + m_transform.m_translation.m_y;
+
+		box = {std::min(box[0], x), std::min(box[1], y), std::max(box[2], x), std::max(box[3], y)};
+	}
+
+	// off screen, or a grid that is only sized once the first frame ended
+	auto tile = static_cast<std::float_t>(settings::damage::tile_size);
+	if (!m_damage.m_columns || box[2] < 0.0f || box[3] < 0.0f)
+		return;
+
+	auto left = static_cast<std::uint32_t>(std::max(box[0], 0.0f) / tile);
+	auto top = static_cast<std::uint32_t>(std::max(box[1], 0.0f) / tile);
+	auto right = std::min(static_cast<std::uint32_t>(box[2] / tile), m_damage.m_columns - 1);
+	auto bottom = std::min(static_cast<std::uint32_t>(box[3] / tile), m_damage.m_rows - 1);
+
+	// order dependent, a primitive moving above another changes the tile
+	for (auto y = top; y <= bottom; y++)
+		for (auto x = left; x <= right; x++)
+		{
+			auto& hash = m_damage.m_tiles[y * m_damage.m_columns + x];
+			hash = (hash ^ value) * std::uint64_t{0x100000001b3};
+		}
+}
+
+auto draw::scene_t::find_damage() -> bool
+{
+	auto resolution = this->get_resolution();
+	auto tile = static_cast<std::int32_t>(settings::damage::tile_size);
+
+	m_damage.m_rects.clear();
+
+	// runs of changed tiles along each row, the presentation engine takes them as they are
+	auto changed = m_damage.m_full;
+	for (auto y = std::uint32_t{0}; y < m_damage.m_rows && !m_damage.m_full; y++)
+		for (auto x = std::uint32_t{0}; x < m_damage.m_columns; x++)
+		{
+			auto index = y * m_damage.m_columns + x;
+			if (m_damage.m_tiles[index] == m_damage.m_presented[index])
+				continue;
+
+			auto first = x;
+			for (; x + 1 < m_damage.m_columns && m_damage.m_tiles[index + 1] != m_damage.m_presented[index + 1]; x++, index++);
+
+			auto offset = VkOffset2D{static_cast<std::int32_t>(first) * tile, static_cast<std::int32_t>(y) * tile};
+			auto extent = VkExtent2D{
+				static_cast<std::uint32_t>(std::min(static_cast<std::int32_t>(x + 1) * tile, resolution.m_x) - offset.x),
+				static_cast<std::uint32_t>(std::min(offset.y + tile, resolution.m_y) - offset.y)
+			};
+
+			m_damage.m_rects.push_back(VkRectLayerKHR{offset, extent, 0});
+			changed = true;
+		}
 
+	// too many to be worth it, the whole image is presented
+	if (m_damage.m_full || m_damage.m_rects.size() > settings::damage::max_rects)
+		m_damage.m_rects.clear();
 
-auto draw::scene_t::mesh(std::vector<vertex_t> points) -> void
+	return changed;
+}
+
+auto draw::scene_t::bind_clip(const draw_command_t& command, bool culling) -> void
+{
+	auto id = static_cast<std::uint32_t>((command.m_key >> settings::sort_key::clip_shift) & settings::sort_key::clip_mask);
+
+	if (culling) m_renderer->set_cull_clip(id, id ? &m_clips[id - 1] : nullptr);
+	else m_renderer->set_clip(id, id ? &m_clips[id - 1] : nullptr);
+}
+
+auto draw::scene_t::command(draw_kind kind, std::uint32_t first, std::uint32_t count, std::uint8_t texture, std::uint8_t state) -> void
+{
+	auto key = this->make_key(kind, texture, state);
+
+	// back to back submissions with the same state extend the last command
+	if (!m_commands.empty() && (m_commands.back().m_key & settings::sort_key::state_mask) == key && m_commands.back().m_first + m_commands.back().m_count == first)
+	{
+		m_commands.back().m_count += count;
+		return;
+	}
+
+	// submission order in the low bits keeps the sort stable inside a layer
+	m_commands.push_back(draw_command_t{key | static_cast<std::uint64_t>(m_commands.size()) << settings::sort_key::order_shift, kind, first, count});
+}
+
+auto draw::scene_t::sort_commands() -> void
+{
+	if (m_commands.empty())
+		return;
+
+	// lsd radix sort, a byte per pass, skipping bytes every key shares
+	m_sorted.resize(m_commands.size());
+	for (auto shift = std::uint32_t{0}; shift < 64; shift += 8)
+	{
+		auto offsets = std::array<std::uint32_t, 256>{};
+		for (const auto& command : m_commands)
+			offsets[(command.m_key >> shift) & 0xff]++;
+
+		if (offsets[(m_commands.front().m_key >> shift) & 0xff] == m_commands.size())
+			continue;
+
+		// counts to first slots
+		for (auto sum = std::uint32_t{0}; auto& offset : offsets)
+		{
+			auto count = offset;
+			offset = sum;
+			sum += count;
+		}
+
+		for (const auto& command : m_commands)
+			m_sorted[offsets[(command.m_key >> shift) & 0xff]++] = command;
+
+		m_commands.swap(m_sorted);
+	}
+
+	// neighbours with the same state whose ranges continue each other become one draw
+	auto merged = std::size_t{0};
+	for (auto i = std::size_t{1}; i < m_commands.size(); i++)
+	{
+		auto& last = m_commands[merged];
+		const auto& command = m_commands[i];
+
+		if ((last.m_key & settings::sort_key::state_mask) == (command.m_key & settings::sort_key::state_mask) && last.m_first + last.m_count == command.m_first)
+			last.m_count += command.m_count;
+		else
+			m_commands[++merged] = command;
+	}
+
+	m_commands.resize(merged + 1);
+}
+
+auto draw::scene_t::mesh(std::vector<vertex_t> points, edge_mode edge) -> void
 {
 	if (points.size() < 3)
 		return;
 
-	auto info = mesh_info_t{}; // arbitrary amount of points in a mesh
-	
-	for (auto point : points)
-		info.m_vertices.push_back(point.to_absolute(window::res_vec));
+	this->digest_bytes(points.data(), sizeof(vertex_t) * points.size());
+	this->digest(edge);
+
+	auto half_feather = edge == edge_mode::feathered ? settings::antialias::feather * 0.5f : 0.0f;
+
+	// pixel bounds of the call, rejected against the clip here and against the screen when gpu culling is on
+	auto bounds = std::array<std::float_t, 4>{points[0].m_pos.m_x, points[0].m_pos.m_y, points[0].m_pos.m_x, points[0].m_pos.m_y};
+	auto opaque = true;
+	for (const auto& point : points)
+	{
+		bounds[0] = std::min(bounds[0], point.m_pos.m_x);
+		bounds[1] = std::min(bounds[1], point.m_pos.m_y);
+		bounds[2] = std::max(bounds[2], point.m_pos.m_x);
+		bounds[3] = std::max(bounds[3], point.m_pos.m_y);
+		opaque &= point.m_col.m_a == 255;
+	}
+
+	bounds = {bounds[0] - half_feather, bounds[1] - half_feather, bounds[2] + half_feather, bounds[3] + half_feather};
+	if (this->rejected(bounds))
+		return;
+
+	// feathered edges pull the outline in by half the feather, a ring fading out reaches as far past it
+	auto outline = std::vector<std::uint32_t>{};
+	auto offsets = std::vector<vec2_t<std::float_t>>{};
+	if (half_feather > 0.0f)
+	{
+		outline = this->strip_outline(static_cast<std::uint32_t>(points.size()));
+		offsets.resize(points.size(), vec2_t{0.0f, 0.0f});
+
+		// the outward normal is on the right of an edge when the outline's signed area is positive
+		auto area = 0.0f;
+		for (auto k = std::size_t{0}; k < outline.size(); k++)
+		{
+			const auto& a = points[outline[k]].m_pos;
+			const auto& b = points[outline[(k + 1) % outline.size()]].m_pos;
+			area += a.m_x * b.m_y - b.m_x * a.m_y;
+		}
+
+		auto winding = area < 0.0f ? -1.0f : 1.0f;
+		auto normal = [&](const vec2_t<std::float_t>& a, const vec2_t<std::float_t>& b)
+		{
+			auto delta = b - a;
+			auto length = std::hypot(delta.m_x, delta.m_y);
+			return length > 1e-6f ? vec2_t{delta.m_y / length * winding, -delta.m_x / length * winding} : vec2_t{0.0f, 0.0f};
+		};
+
+		for (auto k = std::size_t{0}; k < outline.size(); k++)
+		{
+			const auto& prev = points[outline[(k + outline.size() - 1) % outline.size()]].m_pos;
+			const auto& point = points[outline[k]].m_pos;
+			const auto& next = points[outline[(k + 1) % outline.size()]].m_pos;
+
+			auto in_normal = normal(prev, point);
+			auto out_normal = normal(point, next);
+			if (!in_normal) in_normal = out_normal;
+			if (!out_normal) out_normal = in_normal;
+
+			// miter, (n1 + n2) * 2 / |n1 + n2|^2 is a unit distance from both edges, clamped at sharp corners
+			auto sum = in_normal + out_normal;
+			auto length_sq = sum.m_x * sum.m_x + sum.m_y * sum.m_y;
+			auto scale = 2.0f / std::max(length_sq, 4.0f / (settings::antialias::max_miter * settings::antialias::max_miter));
+
+			offsets[outline[k]] = sum * (scale * half_feather);
+		}
+
+		for (auto i = std::size_t{0}; i < points.size(); i++)
+			points[i].m_pos = points[i].m_pos - offsets[i];
+	}
+
+	auto base = static_cast<std::uint32_t>(m_meshes.m_vertices.m_data.size());
+	auto first_index = static_cast<std::uint32_t>(m_meshes.m_indices.size());
+	auto depth = this->next_depth();
+
+	m_meshes.m_vertices.m_data.insert(m_meshes.m_vertices.m_data.end(), points.begin(), points.end());
+	m_meshes.m_depths.m_data.insert(m_meshes.m_depths.m_data.end(), points.size(), depth);
+
+	// points are laid out as a strip, expand it into a triangle list so every mesh shares one draw
+	for (auto i = std::uint32_t{0}; i + 2 < points.size(); i++)
+		m_meshes.m_indices.insert(m_meshes.m_indices.end(), {base + i, base + i + 1, base + i + 2});
+
+	auto draw = mesh_draw_t{bounds, first_index, static_cast<std::uint32_t>(m_meshes.m_indices.size()) - first_index};
+
+	// opaque meshes write depth and are drawn ahead of the command stream, translucent, clipped and cached ones keep their place in it
+	if (opaque && !this->clip_id() && m_target == settings::sort_key::screen_target)
+		m_meshes.m_opaque.push_back(draw);
+	else
+	{
+		m_meshes.m_draws.push_back(draw);
+		this->command(draw_kind::mesh, static_cast<std::uint32_t>(m_meshes.m_draws.size() - 1), 1);
+	}
+
+	if (outline.empty())
+		return;
+
+	// the ring is translucent even around an opaque interior, it always keeps its place in the stream
+	// and goes through the pipeline that leaves depth alone, its invisible fringe must not clip what's drawn later
+	auto ring_base = static_cast<std::uint32_t>(m_meshes.m_vertices.m_data.size());
+	auto ring_first_index = static_cast<std::uint32_t>(m_meshes.m_indices.size());
 
-	m_meshes.m_info.push_back(info);
+	for (auto index : outline)
+	{
+		auto outer = points[index];
+		outer.m_pos = outer.m_pos + offsets[index] * 2.0f;
+		outer.m_col.m_a = 0;
+
+		m_meshes.m_vertices.m_data.push_back(outer);
+	}
+
+	m_meshes.m_depths.m_data.insert(m_meshes.m_depths.m_data.end(), outline.size(), depth);
+
+	for (auto k = std::uint32_t{0}; k < outline.size(); k++)
+	{
+		auto next = (k + 1) % static_cast<std::uint32_t>(outline.size());
+		m_meshes.m_indices.insert(m_meshes.m_indices.end(), {
+			base + outline[k], base + outline[next], ring_base + k,
+			ring_base + k, base + outline[next], ring_base + next
+		});
+	}
+
+	m_meshes.m_draws.push_back(mesh_draw_t{bounds, ring_first_index, static_cast<std::uint32_t>(m_meshes.m_indices.size()) - ring_first_index});
+	this->command(draw_kind::mesh, static_cast<std::uint32_t>(m_meshes.m_draws.size() - 1), 1);
+}
+
+auto draw::scene_t::strip_outline(std::uint32_t count) -> std::vector<std::uint32_t>
+{
+	// a strip's boundary runs up its even points and back down the odd ones
+	auto outline = std::vector<std::uint32_t>{};
+	for (auto i = std::uint32_t{0}; i < count; i += 2)
+		outline.push_back(i);
+
+	for (auto i = static_cast<std::int32_t>(count % 2 ? count - 2 : count - 1); i > 0; i -= 2)
+		outline.push_back(static_cast<std::uint32_t>(i));
+
+	return outline;
 }
 
-auto draw::scene_t::mesh(rect_t rect, color_t color) -> void
+auto draw::scene_t::mesh(rect_t rect, color_t color, edge_mode edge) -> void
 {
 	this->mesh(
 		std::vector<vertex_t>{
@@ -38,11 +428,102 @@ auto draw::scene_t::mesh(rect_t rect, color_t color) -> void
 			vertex_t(rect.m_x, rect.m_y + rect.m_height, color),
 			vertex_t(rect.m_x + rect.m_width, rect.m_y, color),
 			vertex_t(rect.m_x + rect.m_width, rect.m_y + rect.m_height, color),
-		}
+		},
+		edge
 	);
 }
 
-auto draw::scene_t::circle(vertex_t center, std::uint8_t sides, std::uint16_t radius) -> void
+auto draw::scene_t::register_mesh(const std::vector<vertex_t>& points) -> mesh_handle_t
+{
+	// same strip layout as mesh(points), in the mesh's own pixel space
+	auto indices = std::vector<std::uint32_t>{};
+	for (auto i = std::uint32_t{0}; i + 2 < points.size(); i++)
+		indices.insert(indices.end(), {i, i + 1, i + 2});
+
+	auto bounds = std::array<std::float_t, 4>{0.0f, 0.0f, 0.0f, 0.0f};
+	if (!points.empty())
+		bounds = {points[0].m_pos.m_x, points[0].m_pos.m_y, points[0].m_pos.m_x, points[0].m_pos.m_y};
+
+	for (const auto& point : points)
+		bounds = {std::min(bounds[0], point.m_pos.m_x), std::min(bounds[1], point.m_pos.m_y), std::max(bounds[2], point.m_pos.m_x), std::max(bounds[3], point.m_pos.m_y)};
+
+	auto handle = m_renderer->register_mesh(points, indices);
+	if (m_retained_bounds.size() <= handle.m_index)
+		m_retained_bounds.resize(handle.m_index + 1);
+
+	m_retained_bounds[handle.m_index] = bounds;
+	return handle;
+}
+
+auto draw::scene_t::mesh(mesh_handle_t mesh, const transform_t& transform, color_t color) -> void
+{
+	this->digest(mesh.m_index, transform, color);
+
+	// the instance transform is affine, its bounds are spanned by the transformed corners
+	const auto& local = m_retained_bounds.at(mesh.m_index);
+	auto bounds = std::array<std::float_t, 4>{FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+	for (auto corner : {vec2_t{local[0], local[1]}, vec2_t{local[2], local[1]}, vec2_t{local[0], local[3]}, vec2_t{local[2], local[3]}})
+	{
+		auto x = transform.m_a * corner.m_x + transform.m_b * corner.m_y + transform.m_translation.m_x;
+		auto y = transform.m_c * corner.m_x + transform.m_d * corner.m_y + transform.m_translation.m_y;
+		bounds = {std::min(bounds[0], x), std::min(bounds[1], y), std::max(bounds[2], x), std::max(bounds[3], y)};
+	}
+
+	if (this->rejected(bounds))
+		return;
+
+	m_retained.m_instances.m_data.push_back(mesh_instance_t{transform, color, this->next_depth()});
+
+	// extend the current run while the same mesh is drawn back to back in the same layer
+	auto extends =
+		!m_retained.m_draws.empty() && m_retained.m_draws.back().m_mesh.m_index == mesh.m_index &&
+		(m_commands.back().m_key & settings::sort_key::state_mask) == this->make_key(draw_kind::retained);
+
+	if (extends)
+		m_retained.m_draws.back().m_instance_count++;
+	else
+	{
+		m_retained.m_draws.push_back(retained_draw_t{mesh, static_cast<std::uint32_t>(m_retained.m_instances.m_data.size() - 1), 1});
+		this->command(draw_kind::retained, static_cast<std::uint32_t>(m_retained.m_draws.size() - 1), 1);
+	}
+}
+
+auto draw::scene_t::polygon(const std::vector<vertex_t>& points, color_t color, fill_rule rule) -> void
+{
+	if (points.size() < 3)
+		return;
+
+	this->digest_bytes(points.data(), sizeof(vertex_t) * points.size());
+	this->digest(color, rule);
+
+	auto bounds = std::array<std::float_t, 4>{points[0].m_pos.m_x, points[0].m_pos.m_y, points[0].m_pos.m_x, points[0].m_pos.m_y};
+	for (const auto& point : points)
+	{
+		bounds[0] = std::min(bounds[0], point.m_pos.m_x);
+		bounds[1] = std::min(bounds[1], point.m_pos.m_y);
+		bounds[2] = std::max(bounds[2], point.m_pos.m_x);
+		bounds[3] = std::max(bounds[3], point.m_pos.m_y);
+	}
+
+	if (this->rejected(bounds))
+		return;
+
+	auto base = static_cast<std::uint32_t>(m_polygons.m_vertices.m_data.size());
+	auto first_index = static_cast<std::uint32_t>(m_polygons.m_indices.m_data.size());
+
+	m_polygons.m_vertices.m_data.insert(m_polygons.m_vertices.m_data.end(), points.begin(), points.end());
+
+	// a fan around the first point, overlaps cancel out in the stencil so concave and self intersecting outlines fill correctly
+	for (auto i = std::uint32_t{1}; i + 1 < points.size(); i++)
+		m_polygons.m_indices.m_data.insert(m_polygons.m_indices.m_data.end(), {base, base + i, base + i + 1});
+
+	m_polygons.m_covers.m_data.push_back(polygon_cover_t{bounds, color, this->next_depth()});
+	m_polygons.m_draws.push_back(polygon_draw_t{first_index, static_cast<std::uint32_t>(m_polygons.m_indices.m_data.size()) - first_index, rule});
+
+	this->command(draw_kind::polygon, static_cast<std::uint32_t>(m_polygons.m_draws.size() - 1), 1, 0, static_cast<std::uint8_t>(rule));
+}
+
+auto draw::scene_t::circle(vertex_t center, std::uint8_t sides, std::uint16_t radius, edge_mode edge) -> void
 {
 	auto vertices = std::vector<vertex_t>{};
 	auto side_rot = (constants::pi * 2) / sides;
@@ -60,10 +541,10 @@ auto draw::scene_t::circle(vertex_t center, std::uint8_t sides, std::uint16_t ra
 		);
 	}
 	
-	this->mesh(vertices);
+	this->mesh(vertices, edge);
 }
 
-auto draw::scene_t::circle(vertex_t center, std::uint8_t sides, std::uint16_t radius, std::float_t line_width, const color_t* override) -> void
+auto draw::scene_t::circle(vertex_t center, std::uint8_t sides, std::uint16_t radius, std::float_t line_width, const color_t* override, edge_mode edge) -> void
 {
 	auto vertices = std::vector<vertex_t>{};
 	auto side_rot = (constants::pi * 2) / sides;
@@ -81,80 +562,158 @@ auto draw::scene_t::circle(vertex_t center, std::uint8_t sides, std::uint16_t ra
 		);
 	}
 
-	this->line(vertices, line_width);
+	this->line(vertices, line_width, nullptr, line_cap::butt, edge);
 }
 
-auto draw::scene_t::line(vertex_t from, vertex_t to, std::float_t width) -> void
+auto draw::scene_t::circle(vertex_t center, std::float_t radius) -> void
 {
-	m_lines.m_info.push_back(
-		line_info_t{
-			std::vector<vertex_t>{
-				from.to_absolute(window::res_vec),
-				to.to_absolute(window::res_vec)
-			},
-			width
-		}
-	);
+	this->arc(center, radius, 0.0f, 0.0f, constants::pi * 2);
+}
+
+auto draw::scene_t::ring(vertex_t center, std::float_t radius, std::float_t thickness) -> void
+{
+	this->arc(center, radius, thickness, 0.0f, constants::pi * 2);
+}
+
+auto draw::scene_t::arc(vertex_t center, std::float_t radius, std::float_t thickness, std::float_t start, std::float_t sweep) -> void
+{
+	this->digest(center, radius, thickness, start, sweep);
+
+	// same reach as cull.comp, a pixel of anti aliasing past the edge
+	auto reach = radius + 1.0f;
+	if (this->rejected({center.m_pos.m_x - reach, center.m_pos.m_y - reach, center.m_pos.m_x + reach, center.m_pos.m_y + reach}))
+		return;
+
+	m_shapes.m_shapes.m_data.push_back(shape_instance_t{center.m_pos, vec2_t{radius, radius}, radius, thickness, start, sweep, center.m_col, this->next_depth()});
+	this->command(draw_kind::shape, static_cast<std::uint32_t>(m_shapes.m_shapes.m_data.size() - 1), 1);
+}
+
+auto draw::scene_t::rounded_rect(rect_t rect, std::float_t corner, color_t color, std::float_t thickness) -> void
+{
+	this->digest(rect, corner, color, thickness);
+
+	auto half_size = vec2_t{rect.m_width / 2.0f, rect.m_height / 2.0f};
+	auto center = vec2_t{rect.m_x + half_size.m_x, rect.m_y + half_size.m_y};
+
+	if (this->rejected({center.m_x - half_size.m_x - 1.0f, center.m_y - half_size.m_y - 1.0f, center.m_x + half_size.m_x + 1.0f, center.m_y + half_size.m_y + 1.0f}))
+		return;
+
+	corner = std::min(corner, std::min(half_size.m_x, half_size.m_y));
+	m_shapes.m_shapes.m_data.push_back(shape_instance_t{center, half_size, corner, thickness, 0.0f, constants::pi * 2, color, this->next_depth()});
+	this->command(draw_kind::shape, static_cast<std::uint32_t>(m_shapes.m_shapes.m_data.size() - 1), 1);
+}
+
+auto draw::scene_t::line(vertex_t from, vertex_t to, std::float_t width, line_cap cap, edge_mode edge) -> void
+{
+	this->digest(from, to, width, cap, edge);
+
+	// caps reach at most half the width past the end points, plus the feather, same bounds as cull.comp
+	auto feather = edge == edge_mode::feathered ? settings::antialias::feather : 0.0f;
+	auto bounds = std::array<std::float_t, 4>{
+		std::min(from.m_pos.m_x, to.m_pos.m_x) - width - feather,
+		std::min(from.m_pos.m_y, to.m_pos.m_y) - width - feather,
+		std::max(from.m_pos.m_x, to.m_pos.m_x) + width + feather,
+		std::max(from.m_pos.m_y, to.m_pos.m_y) + width + feather
+	};
+
+	if (this->rejected(bounds))
+		return;
+
+	// stays in pixels, line.vert expands the quad in screen space
+	m_lines.m_lines.m_data.push_back(line_instance_t{from.m_pos, to.m_pos, from.m_col, to.m_col, width, cap, this->next_depth(), feather});
+	this->command(draw_kind::line, static_cast<std::uint32_t>(m_lines.m_lines.m_data.size() - 1), 1);
 }
 
-auto draw::scene_t::line(const std::vector<vertex_t>& points, std::float_t width, const color_t* override) -> void
+auto draw::scene_t::line(const std::vector<vertex_t>& points, std::float_t width, const color_t* override, line_cap cap, edge_mode edge) -> void
 {
 	if (points.size() < 2)
 		return;
+
+	this->digest_bytes(points.data(), sizeof(vertex_t) * points.size());
+	this->digest(width, cap, edge);
+	if (override) this->digest(*override);
+
+	auto feather = edge == edge_mode::feathered ? settings::antialias::feather : 0.0f;
+
+	auto depth = this->next_depth(); // one primitive, the segments don't occlude each other
+	auto first = static_cast<std::uint32_t>(m_lines.m_lines.m_data.size());
 	
-	auto old_pos = vertex_t{points.front().m_pos.m_x, points.front().m_pos.m_y, override ? *override : points.front().m_col};
 	for (auto i = std::uint32_t{1}; i != points.size(); i++)
 	{
-		auto point = vertex_t{points.at(i).m_pos.m_x, points.at(i).m_pos.m_y, override ? *override : points.at(i).m_col};
-		
-		this->line(old_pos, point, width);
-		old_pos = point;
+		const auto& from = points.at(i - 1);
+		const auto& to = points.at(i);
+
+		// segments are independent instances, the ones outside the clip are dropped
+		auto bounds = std::array<std::float_t, 4>{
+			std::min(from.m_pos.m_x, to.m_pos.m_x) - width - feather,
+			std::min(from.m_pos.m_y, to.m_pos.m_y) - width - feather,
+			std::max(from.m_pos.m_x, to.m_pos.m_x) + width + feather,
+			std::max(from.m_pos.m_y, to.m_pos.m_y) + width + feather
+		};
+
+		if (this->rejected(bounds))
+			continue;
+
+		m_lines.m_lines.m_data.push_back(
+			line_instance_t{
+				from.m_pos,
+				to.m_pos,
+				override ? *override : from.m_col,
+				override ? *override : to.m_col,
+				width,
+				cap,
+				depth,
+				feather
+			}
+		);
 	}
+
+	if (m_lines.m_lines.m_data.size() > first)
+		this->command(draw_kind::line, first, static_cast<std::uint32_t>(m_lines.m_lines.m_data.size()) - first);
 }
 
 auto draw::scene_t::text(vertex_t abs, const std::string& text, std::float_t size, bool center) -> void
 {
-	abs.to_absolute(window::res_vec);
-	
-	auto char_w = (size / 10.0f) * 1.0f / window::res_vk.width;
-	auto char_h = (size / 10.0f) * 1.0f / window::res_vk.height;
+	auto scale = size / 20.0f; // screen pixels per font pixel
 	
 	// same width for every consolas character
 	auto advance = (&m_text.m_font_data[static_cast<std::uint32_t>(0x61) - settings::font::first_char])->advance;
 	
 	if (center) // center text horizontally and vertically
 	{
-		abs.m_pos.m_x -= (char_w * advance * text.size()) / 2;
-		abs.m_pos.m_y -= (advance * char_h) / 1.5;
+		abs.m_pos.m_x -= (scale * advance * text.size()) / 2;
+		abs.m_pos.m_y -= (advance * scale) / 1.5;
 	}
 
-	auto info = text_info_t{}; // arbitrary amount of characters in a label
+	this->digest_bytes(text.data(), text.size());
+	this->digest(abs, size);
+
+	auto depth = this->next_depth();
+	auto first = static_cast<std::uint32_t>(m_text.m_glyphs.m_data.size());
 
 	for (auto letter : text)
 	{
-		auto char_data = &m_text.m_font_data[static_cast<std::uint32_t>(letter) - settings::font::first_char];
-		
-		info.m_vertices.push_back(text_vertex_t{
-			vec2_t{abs.m_pos.m_x + (float)char_data->x0 * char_w, abs.m_pos.m_y + (float)char_data->y0 * char_h},
-			vec2_t{char_data->s0, char_data->t0}, abs.m_col
-			});
-		info.m_vertices.push_back(text_vertex_t{
-			vec2_t{abs.m_pos.m_x + (float)char_data->x1 * char_w, abs.m_pos.m_y + (float)char_data->y0 * char_h},
-			vec2_t{char_data->s1, char_data->t0}, abs.m_col
-			});
-		info.m_vertices.push_back(text_vertex_t{
-			vec2_t{abs.m_pos.m_x + (float)char_data->x0 * char_w, abs.m_pos.m_y + (float)char_data->y1 * char_h},
-			vec2_t{char_data->s0, char_data->t1}, abs.m_col
-			});
-		info.m_vertices.push_back(text_vertex_t{
-			vec2_t{abs.m_pos.m_x + (float)char_data->x1 * char_w, abs.m_pos.m_y + (float)char_data->y1 * char_h},
-			vec2_t{char_data->s1, char_data->t1}, abs.m_col
-		});
+		auto glyph = static_cast<std::uint32_t>(static_cast<std::uint8_t>(letter)) - settings::font::first_char;
+		if (glyph >= settings::font::num_chars) // not in the font
+			continue;
+
+		const auto& box = settings::font::glyph_box;
+		auto bounds = std::array<std::float_t, 4>{
+			abs.m_pos.m_x + box[0] * scale,
+			abs.m_pos.m_y + box[1] * scale,
+			abs.m_pos.m_x + box[2] * scale,
+			abs.m_pos.m_y + box[3] * scale
+		};
 
-		abs.m_pos.m_x += char_data->advance * char_w;
+		// one instance per glyph, quad and uvs are looked up in text.vert
+		if (!this->rejected(bounds))
+			m_text.m_glyphs.m_data.push_back(glyph_instance_t{abs.m_pos, scale, glyph, abs.m_col, depth});
+
+		abs.m_pos.m_x += m_text.m_font_data[glyph].advance * scale;
 	}
 
-	m_text.m_info.push_back(info);
+	if (m_text.m_glyphs.m_data.size() > first)
+		this->command(draw_kind::text, first, static_cast<std::uint32_t>(m_text.m_glyphs.m_data.size()) - first, settings::sort_key::font_texture);
 }
 
 auto draw::scene_t::button(rect_t rect, const std::string& label, std::float_t text_size, bool held, bool center) -> bool
@@ -222,21 +781,215 @@ auto draw::scene_t::debug_info(std::uint32_t fps, std::float_t text_size, color_
 	// draw crosshar
 	if (crosshair) 
 	{
+		auto resolution = this->get_resolution();
+
 		this->line(
 			vertex_t{0, m_cursor_pos.m_y, color_t{255, 255, 255, 255}},
-			vertex_t{window::res_vec.m_x, m_cursor_pos.m_y, color_t{255, 255, 255, 255}}
+			vertex_t{resolution.m_x, m_cursor_pos.m_y, color_t{255, 255, 255, 255}}
 		);
 
 		this->line(
 			vertex_t{m_cursor_pos.m_x, 0, color_t{255, 255, 255, 255}},
-			vertex_t{m_cursor_pos.m_x, window::res_vec.m_y, color_t{255, 255, 255, 255}}
+			vertex_t{m_cursor_pos.m_x, resolution.m_y, color_t{255, 255, 255, 255}}
 		);
 	}
 }
 
+auto draw::scene_t::set_transform(const transform_t& transform) -> void
+{
+	// cached layers hold pixels drawn under the old transform
+	auto changed =
+		transform.m_a != m_transform.m_a || transform.m_b != m_transform.m_b ||
+		transform.m_c != m_transform.m_c || transform.m_d != m_transform.m_d ||
+		!(transform.m_translation == m_transform.m_translation);
+
+	if (changed)
+	{
+		for (auto& layer : m_cached_layers)
+			layer.m_dirty = true;
+
+		m_damage.m_full = true; // tiles hashed so far were placed under the old transform
+	}
+
+	m_transform = transform;
+	m_renderer->set_transform(transform); // applies to the whole frame
+}
+
+auto draw::scene_t::set_gpu_culling(bool enabled) -> void
+{
+	m_renderer->set_gpu_culling(enabled);
+}
+
+auto draw::scene_t::set_present_mode(present_mode mode) -> void
+{
+	m_renderer->set_present_mode(mode);
+}
+
+auto draw::scene_t::get_present_mode() -> present_mode
+{
+	return m_renderer->get_present_mode();
+}
+
+auto draw::scene_t::get_resolution() -> point_t
+{
+	auto extent = m_renderer->get_extent();
+	return point_t(static_cast<std::int32_t>(extent.width), static_cast<std::int32_t>(extent.height));
+}
+
+auto draw::scene_t::set_dynamic_resolution(bool enabled) -> void
+{
+	m_renderer->set_dynamic_resolution(enabled);
+}
+
+auto draw::scene_t::get_render_scale() -> std::float_t
+{
+	return m_renderer->get_render_scale();
+}
+
+auto draw::scene_t::set_layer(std::uint8_t layer) -> void
+{
+	this->digest(layer);
+	m_layer = layer; // drawn above every lower layer regardless of submission order
+}
+
+auto draw::scene_t::get_layer() -> std::uint8_t
+{
+	return m_layer;
+}
+
+auto draw::scene_t::push_clip(rect_t rect) -> void
+{
+	this->digest(rect);
+
+	// nested clips intersect with the enclosing one
+	auto clip = std::array<std::float_t, 4>{
+		static_cast<std::float_t>(rect.m_x),
+		static_cast<std::float_t>(rect.m_y),
+		static_cast<std::float_t>(rect.m_x + rect.m_width),
+		static_cast<std::float_t>(rect.m_y + rect.m_height)
+	};
+
+	if (auto parent = this->clip_id())
+	{
+		const auto& bounds = m_clips[parent - 1];
+		clip = {std::max(clip[0], bounds[0]), std::max(clip[1], bounds[1]), std::min(clip[2], bounds[2]), std::min(clip[3], bounds[3])};
+	}
+
+	// the same rect pushed again keeps its id so its commands can still merge
+	if (!m_clips.empty() && m_clips.back() == clip)
+		m_clip_stack.push_back(static_cast<std::uint32_t>(m_clips.size()));
+	else if (m_clips.size() < settings::sort_key::max_clips)
+	{
+		m_clips.push_back(clip);
+		m_clip_stack.push_back(static_cast<std::uint32_t>(m_clips.size()));
+	}
+	else
+		m_clip_stack.push_back(this->clip_id());
+}
+
+auto draw::scene_t::pop_clip() -> void
+{
+	this->digest(std::uint8_t{0}); // what follows is no longer clipped
+
+	if (!m_clip_stack.empty())
+		m_clip_stack.pop_back();
+}
+
+auto draw::scene_t::begin_cached(const std::string& name) -> void
+{
+	// cached layers don't nest, inner ones are part of the outer one
+	if (m_recording_depth++)
+		return;
+
+	auto layer = std::find_if(m_cached_layers.begin(), m_cached_layers.end(), [&](const cached_layer_t& layer) { return layer.m_name == name; });
+	if (layer == m_cached_layers.end())
+	{
+		auto target = m_renderer->create_cached_layer();
+		if (target == ~0u) // out of targets, drawn straight into the frame
+			return;
+
+		m_cached_layers.push_back(cached_layer_t{name, target, 0, {}, true});
+		layer = m_cached_layers.end() - 1;
+	}
+
+	// the layer is built like any other until its digest is known, dropped again at end_cached if it came out clean
+	m_recording = static_cast<std::uint32_t>(layer - m_cached_layers.begin());
+	m_mark = this->mark();
+	m_digest = std::uint64_t{0xcbf29ce484222325};
+	m_recorded_bounds = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+	m_target = layer->m_target;
+}
+
+auto draw::scene_t::end_cached() -> void
+{
+	if (!m_recording_depth || --m_recording_depth || m_recording == ~0u)
+		return;
+
+	auto& layer = m_cached_layers[m_recording];
+	m_recording = ~0u;
+	m_target = settings::sort_key::screen_target;
+
+	// unchanged inputs, composited from last frame's image
+	if (!layer.m_dirty && layer.m_digest == m_digest)
+		this->rewind(m_mark);
+	else
+	{
+		// invalidated or lost layers may hash like the presented frame, they have to be presented anyway
+		this->damage(layer.m_bounds, ++m_damage.m_frame);
+		this->damage(m_recorded_bounds, m_damage.m_frame);
+
+		layer.m_digest = m_digest;
+		layer.m_bounds = m_recorded_bounds;
+		layer.m_dirty = false;
+	}
+
+	// composited like any other primitive of the current layer and clip
+	if (layer.m_bounds[0] > layer.m_bounds[2] || this->rejected(layer.m_bounds))
+		return;
+
+	m_cached.m_instances.m_data.push_back(composite_instance_t{layer.m_bounds, this->next_depth()});
+	m_cached.m_targets.push_back(layer.m_target);
+
+	this->command(draw_kind::cached, static_cast<std::uint32_t>(m_cached.m_instances.m_data.size() - 1), 1, 0, static_cast<std::uint8_t>(layer.m_target));
+}
+
+auto draw::scene_t::invalidate_cached(const std::string& name) -> void
+{
+	for (auto& layer : m_cached_layers)
+		if (layer.m_name == name)
+			layer.m_dirty = true;
+}
+
 auto draw::scene_t::begin() -> void
 {
-	m_renderer->begin_frame();
+	// the swap chain follows the client area, resized before the frame is acquired
+	auto client_rect = RECT{};
+	::GetClientRect(m_wnd, &client_rect);
+	m_renderer->set_extent(VkExtent2D{static_cast<std::uint32_t>(client_rect.right - client_rect.left), static_cast<std::uint32_t>(client_rect.bottom - client_rect.top)});
+
+	// new or rescaled targets lost what the cached layers drew into them
+	if (m_renderer->prepare_frame())
+	{
+		for (auto& layer : m_cached_layers)
+			layer.m_dirty = true;
+
+		m_damage.m_full = true;
+	}
+
+	// tiles follow the swap chain, a new grid has nothing to compare with
+	auto resolution = this->get_resolution();
+	auto columns = static_cast<std::uint32_t>(resolution.m_x + settings::damage::tile_size - 1) / settings::damage::tile_size;
+	auto rows = static_cast<std::uint32_t>(resolution.m_y + settings::damage::tile_size - 1) / settings::damage::tile_size;
+	if (columns != m_damage.m_columns || rows != m_damage.m_rows)
+	{
+		m_damage.m_columns = columns;
+		m_damage.m_rows = rows;
+		m_damage.m_presented.assign(columns * rows, 0);
+		m_damage.m_full = true;
+	}
+
+	m_damage.m_tiles.assign(columns * rows, 0);
+	m_damage.m_open = false;
 
 	// update cursor position in scene
 	auto cursor_pos = POINT{};
@@ -246,32 +999,149 @@ auto draw::scene_t::begin() -> void
 	m_cursor_pos = point_t(cursor_pos.x, cursor_pos.y);
 }
 
-auto draw::scene_t::end() -> void
+auto draw::scene_t::render_command(draw_command_t& command) -> void
+{
+	switch (command.m_kind)
+	{
+		case draw_kind::opaque_mesh:
+		case draw_kind::mesh:
+			m_renderer->render_vertices(m_meshes, command);
+			break;
+		case draw_kind::retained:
+			m_renderer->render_vertices(m_retained, command);
+			break;
+		case draw_kind::polygon:
+			m_renderer->render_vertices(m_polygons, command);
+			break;
+		case draw_kind::line:
+			m_renderer->render_vertices(m_lines, command);
+			break;
+		case draw_kind::shape:
+			m_renderer->render_vertices(m_shapes, command);
+			break;
+		case draw_kind::text:
+			m_renderer->render_vertices(m_text, command);
+			break;
+		case draw_kind::cached:
+			m_renderer->render_vertices(m_cached, command);
+			break;
+	}
+}
+
+auto draw::scene_t::end() -> bool
 {
 	m_button.m_current = 0; // current button = first in the list
 
-	if (!m_meshes.m_info.empty())
+	// an unbalanced begin_cached doesn't leak into the next frame
+	m_recording = ~0u;
+	m_recording_depth = 0;
+	m_target = settings::sort_key::screen_target;
+
+	// nothing on screen would change, the last presented image stays up and the gpu stays idle
+	auto changed = this->find_damage() || !settings::damage::skip_idle;
+
+	// a stale swap chain drops the frame, the next one is drawn in full on the rebuilt targets
+	if (changed && this->submit())
 	{
-		m_renderer->allocate_vertices(m_meshes);
-		m_renderer->render_vertices(m_meshes);
-		m_meshes.m_info.clear();
+		m_damage.m_presented.swap(m_damage.m_tiles);
+		m_damage.m_full = false;
 	}
 
-	if (!m_lines.m_info.empty())
+	this->clear();
+	return changed;
+}
+
+auto draw::scene_t::submit() -> bool
+{
+	if (!m_renderer->begin_frame())
+		return false;
+
+	// upload everything first, the ring may grow while it's being filled
+	if (!m_meshes.m_indices.empty()) m_renderer->allocate_vertices(m_meshes);
+	if (!m_retained.m_instances.m_data.empty()) m_renderer->allocate_vertices(m_retained);
+	if (!m_polygons.m_draws.empty()) m_renderer->allocate_vertices(m_polygons);
+	if (!m_lines.m_lines.m_data.empty()) m_renderer->allocate_vertices(m_lines);
+	if (!m_shapes.m_shapes.m_data.empty()) m_renderer->allocate_vertices(m_shapes);
+	if (!m_text.m_glyphs.m_data.empty()) m_renderer->allocate_vertices(m_text);
+	if (!m_cached.m_instances.m_data.empty()) m_renderer->allocate_vertices(m_cached);
+
+	// opaque meshes are a depth pre-pass, a key of just the screen target sorts them ahead of every layer in it, in front so the stable sort keeps them first on a tie
+	if (!m_meshes.m_opaque.empty())
+		m_commands.insert(m_commands.begin(), draw_command_t{static_cast<std::uint64_t>(settings::sort_key::screen_target) << settings::sort_key::target_shift, draw_kind::opaque_mesh, 0, static_cast<std::uint32_t>(m_meshes.m_opaque.size())});
+
+	this->sort_commands();
+
+	// culling runs outside the render pass, then everything is drawn inside it
+	for (auto& command : m_commands)
 	{
-		m_renderer->allocate_vertices(m_lines);
-		m_renderer->render_vertices(m_lines);
-		m_lines.m_info.clear();
+		this->bind_clip(command, true);
+
+		if (command.m_kind == draw_kind::opaque_mesh || command.m_kind == draw_kind::mesh) m_renderer->cull_vertices(m_meshes, command);
+		else if (command.m_kind == draw_kind::line) m_renderer->cull_vertices(m_lines, command);
+		else if (command.m_kind == draw_kind::shape) m_renderer->cull_vertices(m_shapes, command);
+		else if (command.m_kind == draw_kind::text) m_renderer->cull_vertices(m_text, command);
 	}
 
-	if (!m_text.m_info.empty())
+	m_renderer->acquire_uploads();
+	m_renderer->cull();
+
+	// only reads the scene, a large pass calls it from several threads
+	auto record = [this](draw_command_t& command) {
+		this->bind_clip(command);
+		this->render_command(command);
+	};
+
+	auto target_of = [](const draw_command_t& command) {
+		return static_cast<std::uint32_t>((command.m_key >> settings::sort_key::target_shift) & settings::sort_key::target_mask);
+	};
+
+	// one pass per redrawn cached layer, then the swap chain, targets are the top of the key
+	auto target = ~0u;
+	for (auto first = m_commands.begin(); first != m_commands.end(); )
 	{
-		m_renderer->allocate_vertices(m_text);
-		m_renderer->render_vertices(m_text);
-		m_text.m_info.clear();
+		target = target_of(*first);
+		auto last = std::find_if(first, m_commands.end(), [&](const draw_command_t& command) { return target_of(command) != target; });
+
+		m_renderer->record_pass(target, std::span{first, last}, record);
+		first = last;
 	}
 
-	m_renderer->end_frame();
+	// the swap chain is cleared and presented even with nothing on it
+	if (target != settings::sort_key::screen_target)
+		m_renderer->record_pass(settings::sort_key::screen_target, {}, record);
+
+	m_renderer->end_frame(m_damage.m_rects);
+	return true;
+}
+
+auto draw::scene_t::clear() -> void
+{
+	m_meshes.m_vertices.m_data.clear();
+	m_meshes.m_depths.m_data.clear();
+	m_meshes.m_indices.clear();
+	m_meshes.m_opaque.clear();
+	m_meshes.m_draws.clear();
+
+	m_retained.m_instances.m_data.clear();
+	m_retained.m_draws.clear();
+
+	m_polygons.m_vertices.m_data.clear();
+	m_polygons.m_indices.m_data.clear();
+	m_polygons.m_covers.m_data.clear();
+	m_polygons.m_draws.clear();
+
+	m_lines.m_lines.m_data.clear();
+	m_shapes.m_shapes.m_data.clear();
+	m_text.m_glyphs.m_data.clear();
+
+	m_cached.m_instances.m_data.clear();
+	m_cached.m_targets.clear();
+
+	m_commands.clear();
+	m_clips.clear();
+	m_clip_stack.clear();
+	m_layer = 0;
+	m_layer_depths = {};
 }
 
 auto draw::scene_t::get_cursor() -> point_t { return m_cursor_pos; }
\ No newline at end of file
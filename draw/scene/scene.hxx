@@ -21,33 +21,125 @@ namespace draw
 		renderer_t* m_renderer{nullptr};
 
 		mesh_buffer_t m_meshes{};
+		retained_buffer_t m_retained{};
+		polygon_buffer_t m_polygons{};
 		line_buffer_t m_lines{};
+		shape_buffer_t m_shapes{};
 		text_buffer_t m_text{};
+		cached_buffer_t m_cached{};
 
 		point_t m_cursor_pos{};
+
+		std::uint8_t m_layer{0};
+		std::array<std::uint32_t, 256> m_layer_depths{}; // primitives submitted to each layer this frame
+
+		std::vector<std::array<std::float_t, 4>> m_clips{}; // pixel bounds, a command's clip id is its index + 1
+		std::vector<std::uint32_t> m_clip_stack{};
+
+		std::vector<std::array<std::float_t, 4>> m_retained_bounds{}; // per registered mesh, in its own pixel space
+
+		std::vector<cached_layer_t> m_cached_layers{};
+		std::uint32_t m_recording{~0u}; // cached layer primitives currently go to
+		std::uint32_t m_recording_depth{0}; // nested begin_cached calls
+		scene_mark_t m_mark{}; // where the recorded layer's primitives start
+		std::uint64_t m_digest{0};
+		std::array<std::float_t, 4> m_recorded_bounds{};
+		std::uint32_t m_target{settings::sort_key::screen_target};
+
+		transform_t m_transform{};
+
+		// damage tracking, every tile hashes the primitives touching it in submission order
+		struct {
+			std::uint64_t m_primitive{0}; // inputs of the primitive being submitted
+			bool m_open{false}; // inputs were digested since the last primitive was placed
+			bool m_full{true}; // nothing to compare with, the whole frame counts as changed
+			std::uint64_t m_frame{0}; // mixed into tiles that have to be presented regardless of their inputs
+			std::uint32_t m_columns{0};
+			std::uint32_t m_rows{0};
+			std::vector<std::uint64_t> m_tiles{};
+			std::vector<std::uint64_t> m_presented{}; // tiles of the last presented frame
+			std::vector<VkRectLayerKHR> m_rects{};
+		} m_damage;
+
+		std::vector<draw_command_t> m_commands{};
+		std::vector<draw_command_t> m_sorted{}; // radix sort scratch
 		
 		struct {
 			std::uint32_t m_current{0};
 			std::uint32_t m_pushed{~0u};
 		}m_button;
 
+		auto next_depth() -> std::float_t;
+
+		auto make_key(draw_kind kind, std::uint8_t texture = 0, std::uint8_t state = 0) -> std::uint64_t;
+
+		auto clip_id() -> std::uint32_t;
+
+		auto rejected(const std::array<std::float_t, 4>& bounds) -> bool;
+
+		auto mark() -> scene_mark_t;
+
+		auto rewind(const scene_mark_t& mark) -> void;
+
+		auto digest_bytes(const void* data, std::size_t size) -> void;
+
+		template<typename... T>
+		auto digest(const T&... values) -> void
+		{
+			(this->digest_bytes(&values, sizeof(T)), ...);
+		}
+
+		auto damage(const std::array<std::float_t, 4>& bounds, std::uint64_t value) -> void;
+
+		auto find_damage() -> bool;
+
+		// while culling only the clip space is needed, the scissor is recorded inside the pass
+		auto bind_clip(const draw_command_t& command, bool culling = false) -> void;
+
+		auto strip_outline(std::uint32_t count) -> std::vector<std::uint32_t>;
+
+		auto command(draw_kind kind, std::uint32_t first, std::uint32_t count, std::uint8_t texture = 0, std::uint8_t state = 0) -> void;
+
+		auto sort_commands() -> void;
+
+		auto render_command(draw_command_t& command) -> void;
+
+		// false when the frame was dropped before anything was recorded
+		auto submit() -> bool;
+
+		auto clear() -> void;
+
 	public:
 		
 		scene_t(const HWND window_handle);
 		
 		~scene_t();
 		
-		auto mesh(std::vector<vertex_t> points) -> void;
+		auto mesh(std::vector<vertex_t> points, edge_mode edge = edge_mode::aliased) -> void;
+
+		auto mesh(rect_t rect, color_t color, edge_mode edge = edge_mode::aliased) -> void;
+
+		auto register_mesh(const std::vector<vertex_t>& points) -> mesh_handle_t;
 
-		auto mesh(rect_t rect, color_t color) -> void;
+		auto mesh(mesh_handle_t mesh, const transform_t& transform, color_t color = color_t{255, 255, 255, 255}) -> void;
 
-		auto circle(vertex_t center, std::uint8_t sides, std::uint16_t radius) -> void;
+		auto polygon(const std::vector<vertex_t>& points, color_t color, fill_rule rule = fill_rule::non_zero) -> void;
+
+		auto circle(vertex_t center, std::uint8_t sides, std::uint16_t radius, edge_mode edge = edge_mode::aliased) -> void;
 		
-		auto circle(vertex_t center, std::uint8_t sides, std::uint16_t radius, std::float_t line_width, const color_t* override = nullptr) -> void;
+		auto circle(vertex_t center, std::uint8_t sides, std::uint16_t radius, std::float_t line_width, const color_t* override = nullptr, edge_mode edge = edge_mode::aliased) -> void;
+
+		auto circle(vertex_t center, std::float_t radius) -> void;
+
+		auto ring(vertex_t center, std::float_t radius, std::float_t thickness) -> void;
 
-		auto line(vertex_t from, vertex_t to, std::float_t width = 1.0f) -> void;
+		auto arc(vertex_t center, std::float_t radius, std::float_t thickness, std::float_t start, std::float_t sweep) -> void;
+
+		auto rounded_rect(rect_t rect, std::float_t corner, color_t color, std::float_t thickness = 0.0f) -> void;
+
+		auto line(vertex_t from, vertex_t to, std::float_t width = 1.0f, line_cap cap = line_cap::butt, edge_mode edge = edge_mode::aliased) -> void;
 		
-		auto line(const std::vector<vertex_t>& points, std::float_t width = 1.0f, const color_t* override = nullptr) -> void;
+		auto line(const std::vector<vertex_t>& points, std::float_t width = 1.0f, const color_t* override = nullptr, line_cap cap = line_cap::butt, edge_mode edge = edge_mode::aliased) -> void;
 
 		auto text(vertex_t point, const std::string& text, std::float_t size, bool center = false) -> void;
 
@@ -55,9 +147,39 @@ namespace draw
 
 		auto debug_info(std::uint32_t fps, std::float_t text_size, color_t text_color, bool cursor_pos = false, bool crosshair = false) -> void;
 
+		auto set_transform(const transform_t& transform) -> void;
+
+		auto set_gpu_culling(bool enabled) -> void;
+
+		auto set_present_mode(present_mode mode) -> void;
+
+		auto get_present_mode() -> present_mode;
+
+		// of the swap chain, in the pixels primitives are given in
+		auto get_resolution() -> point_t;
+
+		auto set_dynamic_resolution(bool enabled) -> void;
+
+		auto get_render_scale() -> std::float_t;
+
+		auto set_layer(std::uint8_t layer) -> void;
+
+		auto push_clip(rect_t rect) -> void;
+
+		auto pop_clip() -> void;
+
+		auto begin_cached(const std::string& name) -> void;
+
+		auto end_cached() -> void;
+
+		auto invalidate_cached(const std::string& name) -> void;
+
+		auto get_layer() -> std::uint8_t;
+
 		auto begin() -> void;
 
-		auto end() -> void;
+		// false when the frame matched the last presented one and was neither recorded nor presented, a dropped frame still counts as changed
+		auto end() -> bool;
 
 		auto get_cursor() -> point_t;
 	};
@@ -1,7 +1,26 @@
-C:\VulkanSDK\1.3.224.1\Bin\glslc.exe mesh.vert -o mesh.vert.spv
-C:\VulkanSDK\1.3.224.1\Bin\glslc.exe mesh.frag -o mesh.frag.spv
+@echo off
+rem the pre-build event passes "nobreak", the output is embedded through shaders.hxx
+cd /d "%~dp0"
+if not exist gen mkdir gen
 
-C:\VulkanSDK\1.3.224.1\Bin\glslc.exe text.vert -o text.vert.spv
-C:\VulkanSDK\1.3.224.1\Bin\glslc.exe text.frag -o text.frag.spv
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe mesh.vert -mfmt=num -o gen\mesh.vert.spv.inc || exit /b 1
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe mesh.frag -mfmt=num -o gen\mesh.frag.spv.inc || exit /b 1
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe retained.vert -mfmt=num -o gen\retained.vert.spv.inc || exit /b 1
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe cover.vert -mfmt=num -o gen\cover.vert.spv.inc || exit /b 1
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe winding.vert -mfmt=num -o gen\winding.vert.spv.inc || exit /b 1
 
-pause
\ No newline at end of file
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe line.vert -mfmt=num -o gen\line.vert.spv.inc || exit /b 1
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe line.frag -mfmt=num -o gen\line.frag.spv.inc || exit /b 1
+
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shape.vert -mfmt=num -o gen\shape.vert.spv.inc || exit /b 1
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe shape.frag -mfmt=num -o gen\shape.frag.spv.inc || exit /b 1
+
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe text.vert -mfmt=num -o gen\text.vert.spv.inc || exit /b 1
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe text.frag -mfmt=num -o gen\text.frag.spv.inc || exit /b 1
+
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe composite.vert -mfmt=num -o gen\composite.vert.spv.inc || exit /b 1
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe composite.frag -mfmt=num -o gen\composite.frag.spv.inc || exit /b 1
+
+C:\VulkanSDK\1.3.224.1\Bin\glslc.exe cull.comp -mfmt=num -o gen\cull.comp.spv.inc || exit /b 1
+
+if not "%1"=="nobreak" pause
\ No newline at end of file
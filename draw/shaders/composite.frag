@@ -0,0 +1,11 @@
+#version 460
+
+layout (binding = 0) uniform sampler2D sampler_layer;
+
+layout (location = 0) out vec4 out_color;
+
+void main()
+{
+	// the layer matches the target pixel for pixel, its colors are already premultiplied
+	out_color = texelFetch(sampler_layer, ivec2(gl_FragCoord.xy), 0);
+}
\ No newline at end of file
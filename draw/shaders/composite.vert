@@ -0,0 +1,24 @@
+#version 460
+
+// per cached layer instance, the bounds its content was drawn in
+layout (location = 0) in vec4 in_bounds; // min x, min y, max x, max y in pixels
+layout (location = 1) in float in_depth; // submission order
+
+layout (push_constant) uniform constants
+{
+	vec4 row_x; // pixels to clip space, projection * transform
+	vec4 row_y;
+};
+
+vec4 project(vec2 pos, float depth)
+{
+	return vec4(dot(row_x.xyz, vec3(pos, 1.0)), dot(row_y.xyz, vec3(pos, 1.0)), depth, 1.0);
+}
+
+void main()
+{
+	// quad corner of the 4 vertex strip, under the same transform the layer was drawn with
+	vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+
+	gl_Position = project(mix(in_bounds.xy, in_bounds.zw, corner), in_depth);
+}
\ No newline at end of file
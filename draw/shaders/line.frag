@@ -0,0 +1,37 @@
+#version 460
+
+layout (location = 0) in vec2 in_local;
+layout (location = 1) in vec4 in_color;
+layout (location = 2) flat in float in_length;
+layout (location = 3) flat in float in_radius;
+layout (location = 4) flat in uint in_cap;
+layout (location = 5) flat in float in_feather;
+
+layout (location = 0) out vec4 out_color;
+
+const uint cap_butt = 0;
+const uint cap_round = 2;
+
+void main()
+{
+	// signed distance to the outline in pixels, negative inside
+	float dist;
+	if (in_cap == cap_round)
+		dist = length(in_local - vec2(clamp(in_local.x, 0.0, in_length), 0.0)) - in_radius;
+	else
+	{
+		float reach = in_cap == cap_butt ? 0.0 : in_radius;
+		dist = max(max(-in_local.x, in_local.x - in_length) - reach, abs(in_local.y) - in_radius);
+	}
+
+	// hard edges only cut round caps out of their square extension, feathered ones fade over the feather
+	if (in_feather == 0.0)
+	{
+		if (in_cap == cap_round && dist > 0.0)
+			discard;
+
+		out_color = in_color;
+	}
+	else
+		out_color = vec4(in_color.rgb, in_color.a * clamp(0.5 - dist / in_feather, 0.0, 1.0));
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#version 460
+
+// per segment instance, positions and width in pixels
+layout (location = 0) in vec2 in_from;
+layout (location = 1) in vec2 in_to;
+layout (location = 2) in vec4 in_from_color;
+layout (location = 3) in vec4 in_to_color;
+layout (location = 4) in float in_width;
+layout (location = 5) in uint in_cap;
+layout (location = 6) in float in_depth; // submission order
+layout (location = 7) in float in_feather; // pixels the edge fades over, 0 for a hard edge
+
+layout (push_constant) uniform constants
+{
+	vec4 row_x; // pixels to clip space, projection * transform
+	vec4 row_y;
+};
+
+vec4 project(vec2 pos, float depth)
+{
+	return vec4(dot(row_x.xyz, vec3(pos, 1.0)), dot(row_y.xyz, vec3(pos, 1.0)), depth, 1.0);
+}
+
+layout (location = 0) out vec2 out_local; // pixels along / across the segment
+layout (location = 1) out vec4 out_color;
+layout (location = 2) flat out float out_length;
+layout (location = 3) flat out float out_radius;
+layout (location = 4) flat out uint out_cap;
+layout (location = 5) flat out float out_feather;
+
+const uint cap_butt = 0;
+
+void main()
+{
+	vec2 delta = in_to - in_from;
+	float len = length(delta);
+	vec2 dir = len > 0.0 ? delta / len : vec2(1.0, 0.0);
+	vec2 normal = vec2(-dir.y, dir.x);
+
+	float radius = max(in_width, 1.0) * 0.5;
+	float extend = (in_cap == cap_butt ? 0.0 : radius) + in_feather; // square and round caps reach past the end points
+
+	// quad corner of the 4 vertex strip, grown by the feather on every side
+	float along = float(gl_VertexIndex & 1);
+	float across = (gl_VertexIndex >> 1) == 0 ? -radius - in_feather : radius + in_feather;
+
+	vec2 local = vec2(mix(-extend, len + extend, along), across);
+	vec2 pos = in_from + dir * local.x + normal * local.y;
+
+	gl_Position = project(pos, in_depth);
+	out_local = local;
+	out_color = mix(in_from_color, in_to_color, clamp(local.x / max(len, 1.0), 0.0, 1.0));
+	out_length = len;
+	out_radius = radius;
+	out_cap = in_cap;
+	out_feather = in_feather;
+}
\ No newline at end of file
@@ -2,11 +2,23 @@
 
 layout(location = 0) in vec2 in_position;
 layout(location = 1) in vec4 in_color;
+layout(location = 2) in float in_depth; // submission order, from a second vertex stream
 
 layout (location = 0) out vec4 out_color;
 
+layout (push_constant) uniform constants
+{
+	vec4 row_x; // pixels to clip space, projection * transform
+	vec4 row_y;
+};
+
+vec4 project(vec2 pos, float depth)
+{
+	return vec4(dot(row_x.xyz, vec3(pos, 1.0)), dot(row_y.xyz, vec3(pos, 1.0)), depth, 1.0);
+}
+
 void main()
 {
-	gl_Position = vec4(in_position, 0.0, 1.0);
+	gl_Position = project(in_position, in_depth);
 	out_color = in_color;
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 460
+
+layout (location = 0) in vec2 in_position; // mesh pixels
+layout (location = 1) in vec4 in_color;
+
+// per instance
+layout (location = 2) in vec4 in_transform; // a, b, c, d
+layout (location = 3) in vec2 in_translation;
+layout (location = 4) in vec4 in_tint;
+layout (location = 5) in float in_depth; // submission order
+
+layout (location = 0) out vec4 out_color;
+
+layout (push_constant) uniform constants
+{
+	vec4 row_x; // pixels to clip space, projection * transform
+	vec4 row_y;
+};
+
+vec4 project(vec2 pos, float depth)
+{
+	return vec4(dot(row_x.xyz, vec3(pos, 1.0)), dot(row_y.xyz, vec3(pos, 1.0)), depth, 1.0);
+}
+
+void main()
+{
+	vec2 pos = vec2(dot(in_transform.xy, in_position), dot(in_transform.zw, in_position)) + in_translation;
+
+	gl_Position = project(pos, in_depth);
+	out_color = in_color * in_tint;
+}
\ No newline at end of file
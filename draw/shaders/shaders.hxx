@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// spir-v words written by compile.bat (glslc -mfmt=num) before every build
+namespace draw
+{
+	namespace spirv
+	{
+		inline constexpr std::uint32_t mesh_vertex[] = {
+#include "gen/mesh.vert.spv.inc"
+		};
+		inline constexpr std::uint32_t mesh_fragment[] = {
+#include "gen/mesh.frag.spv.inc"
+		};
+
+		inline constexpr std::uint32_t retained_vertex[] = {
+#include "gen/retained.vert.spv.inc"
+		};
+
+		inline constexpr std::uint32_t winding_vertex[] = {
+#include "gen/winding.vert.spv.inc"
+		};
+		inline constexpr std::uint32_t cover_vertex[] = {
+#include "gen/cover.vert.spv.inc"
+		};
+
+		inline constexpr std::uint32_t line_vertex[] = {
+#include "gen/line.vert.spv.inc"
+		};
+		inline constexpr std::uint32_t line_fragment[] = {
+#include "gen/line.frag.spv.inc"
+		};
+
+		inline constexpr std::uint32_t shape_vertex[] = {
+#include "gen/shape.vert.spv.inc"
+		};
+		inline constexpr std::uint32_t shape_fragment[] = {
+#include "gen/shape.frag.spv.inc"
+		};
+
+		inline constexpr std::uint32_t text_vertex[] = {
+#include "gen/text.vert.spv.inc"
+		};
+		inline constexpr std::uint32_t text_fragment[] = {
+#include "gen/text.frag.spv.inc"
+		};
+
+		inline constexpr std::uint32_t composite_vertex[] = {
+#include "gen/composite.vert.spv.inc"
+		};
+		inline constexpr std::uint32_t composite_fragment[] = {
+#include "gen/composite.frag.spv.inc"
+		};
+
+		inline constexpr std::uint32_t cull_compute[] = {
+#include "gen/cull.comp.spv.inc"
+		};
+
+		constexpr auto magic = std::uint32_t{0x07230203};
+
+		template <std::size_t N>
+		constexpr auto valid(const std::uint32_t (&code)[N]) -> bool
+		{
+			return N > 5 && code[0] == magic; // header is five words
+		}
+
+		static_assert(valid(mesh_vertex), "mesh.vert is not spir-v, rerun compile.bat");
+		static_assert(valid(mesh_fragment), "mesh.frag is not spir-v, rerun compile.bat");
+		static_assert(valid(retained_vertex), "retained.vert is not spir-v, rerun compile.bat");
+		static_assert(valid(winding_vertex), "winding.vert is not spir-v, rerun compile.bat");
+		static_assert(valid(cover_vertex), "cover.vert is not spir-v, rerun compile.bat");
+		static_assert(valid(line_vertex), "line.vert is not spir-v, rerun compile.bat");
+		static_assert(valid(line_fragment), "line.frag is not spir-v, rerun compile.bat");
+		static_assert(valid(shape_vertex), "shape.vert is not spir-v, rerun compile.bat");
+		static_assert(valid(shape_fragment), "shape.frag is not spir-v, rerun compile.bat");
+		static_assert(valid(text_vertex), "text.vert is not spir-v, rerun compile.bat");
+		static_assert(valid(text_fragment), "text.frag is not spir-v, rerun compile.bat");
+		static_assert(valid(composite_vertex), "composite.vert is not spir-v, rerun compile.bat");
+		static_assert(valid(composite_fragment), "composite.frag is not spir-v, rerun compile.bat");
+		static_assert(valid(cull_compute), "cull.comp is not spir-v, rerun compile.bat");
+	}
+}
\ No newline at end of file
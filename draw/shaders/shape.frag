@@ -0,0 +1,41 @@
+#version 460
+
+layout (location = 0) in vec2 in_local;
+layout (location = 1) in vec4 in_color;
+layout (location = 2) flat in vec2 in_half_size;
+layout (location = 3) flat in vec4 in_shape;
+
+layout (location = 0) out vec4 out_color;
+
+const float two_pi = 6.28318530718;
+
+void main()
+{
+	float corner = in_shape.x;
+	float thickness = in_shape.y;
+	float arc_start = in_shape.z;
+	float arc_sweep = in_shape.w;
+
+	// signed distance to a rounded box, circles are boxes with corner == half size
+	vec2 q = abs(in_local) - in_half_size + corner;
+	float dist = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - corner;
+
+	// outline grows inwards from the edge
+	if (thickness > 0.0)
+		dist = abs(dist + thickness * 0.5) - thickness * 0.5;
+
+	// cut arcs at their end angles
+	if (arc_sweep < two_pi)
+	{
+		float angle = mod(atan(in_local.y, in_local.x) - arc_start, two_pi);
+		if (angle > arc_sweep)
+			dist = max(dist, min(angle - arc_sweep, two_pi - angle) * length(in_local));
+	}
+
+	// one pixel wide falloff
+	float coverage = clamp(0.5 - dist, 0.0, 1.0);
+	if (coverage <= 0.0)
+		discard;
+
+	out_color = vec4(in_color.rgb, in_color.a * coverage);
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#version 460
+
+// per shape instance, in pixels
+layout (location = 0) in vec2 in_center;
+layout (location = 1) in vec2 in_half_size;
+layout (location = 2) in float in_corner;
+layout (location = 3) in float in_thickness;
+layout (location = 4) in float in_arc_start;
+layout (location = 5) in float in_arc_sweep;
+layout (location = 6) in vec4 in_color;
+layout (location = 7) in float in_depth; // submission order
+
+layout (push_constant) uniform constants
+{
+	vec4 row_x; // pixels to clip space, projection * transform
+	vec4 row_y;
+};
+
+vec4 project(vec2 pos, float depth)
+{
+	return vec4(dot(row_x.xyz, vec3(pos, 1.0)), dot(row_y.xyz, vec3(pos, 1.0)), depth, 1.0);
+}
+
+layout (location = 0) out vec2 out_local; // pixels from the center
+layout (location = 1) out vec4 out_color;
+layout (location = 2) flat out vec2 out_half_size;
+layout (location = 3) flat out vec4 out_shape; // corner, thickness, arc start, arc sweep
+
+void main()
+{
+	// quad corner of the 4 vertex strip, one pixel larger for the edge falloff
+	vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1) * 2.0 - 1.0;
+	vec2 local = corner * (in_half_size + 1.0);
+
+	gl_Position = project(in_center + local, in_depth);
+	out_local = local;
+	out_color = in_color;
+	out_half_size = in_half_size;
+	out_shape = vec4(in_corner, in_thickness, in_arc_start, in_arc_sweep);
+}
\ No newline at end of file
@@ -1,15 +1,45 @@
 #version 460
 
+// per glyph instance, in pixels
 layout (location = 0) in vec2 in_pos;
-layout (location = 1) in vec2 in_uv;
-layout (location = 2) in vec4 in_color;
+layout (location = 1) in float in_scale;
+layout (location = 2) in uint in_glyph;
+layout (location = 3) in vec4 in_color;
+layout (location = 4) in float in_depth; // submission order
+
+struct glyph_t
+{
+	vec4 rect; // x0, y0, x1, y1 in font pixels
+	vec4 uv; // s0, t0, s1, t1
+};
+
+// settings::font::num_chars entries
+layout (binding = 1) uniform glyph_metrics
+{
+	glyph_t glyphs[224];
+};
+
+layout (push_constant) uniform constants
+{
+	vec4 row_x; // pixels to clip space, projection * transform
+	vec4 row_y;
+};
+
+vec4 project(vec2 pos, float depth)
+{
+	return vec4(dot(row_x.xyz, vec3(pos, 1.0)), dot(row_y.xyz, vec3(pos, 1.0)), depth, 1.0);
+}
 
 layout (location = 0) out vec2 out_uv;
 layout (location = 1) out vec4 out_color;
 
 void main()
 {
-	gl_Position = vec4(in_pos, 0.0, 1.0);
-	out_uv = in_uv;
+	// quad corner of the 4 vertex strip
+	vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+	glyph_t glyph = glyphs[in_glyph];
+
+	gl_Position = project(in_pos + mix(glyph.rect.xy, glyph.rect.zw, corner) * in_scale, in_depth);
+	out_uv = mix(glyph.uv.xy, glyph.uv.zw, corner);
 	out_color = in_color;
 }
\ No newline at end of file
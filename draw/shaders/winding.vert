@@ -0,0 +1,20 @@
+#version 460
+
+// polygon outline in pixels, only the stencil is written
+layout(location = 0) in vec2 in_position;
+
+layout (push_constant) uniform constants
+{
+	vec4 row_x; // pixels to clip space, projection * transform
+	vec4 row_y;
+};
+
+vec4 project(vec2 pos, float depth)
+{
+	return vec4(dot(row_x.xyz, vec3(pos, 1.0)), dot(row_y.xyz, vec3(pos, 1.0)), depth, 1.0);
+}
+
+void main()
+{
+	gl_Position = project(in_position, 0.0); // depth is tested by the cover pass
+}
\ No newline at end of file
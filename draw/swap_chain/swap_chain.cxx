@@ -1,28 +1,40 @@
 #include "swap_chain.hxx"
 
+#include <algorithm>
+
 #include "../utils/error.hxx"
 #include "../utils/constants.hxx"
 #include "../utils/settings.hxx"
 #include "../utils/init.hxx"
 
-draw::swap_chain_t::swap_chain_t(VkInstance instance, VkDevice logical_device,
-	const HWND window_handle, std::uint32_t graphics_queue_index)
+draw::swap_chain_t::swap_chain_t(VkInstance instance, VkPhysicalDevice physical_device, VkDevice logical_device,
+	const HWND window_handle, VkExtent2D extent, std::uint32_t graphics_queue_index, bool present_wait, bool incremental_present, present_mode mode, std::uint32_t frames_in_flight)
 	: m_instance{ instance },
-	m_logical_device{ logical_device }
+	m_physical_device{ physical_device },
+	m_logical_device{ logical_device },
+	m_incremental_present{ incremental_present },
+	m_frames{ std::clamp(frames_in_flight, std::uint32_t{ 2 }, std::uint32_t{ 3 }) }
 {
 	this->create_surface(window_handle);
 	this->create_command_pools(graphics_queue_index);
-	this->create_swap_chain();
+	this->create_swap_chain(mode, extent);
 	this->create_image_views();
 	this->allocate_command_buffers();
 	this->create_sync_primitives();
 	this->set_queue_info();
+
+	if (present_wait)
+		m_wait_for_present = reinterpret_cast<PFN_vkWaitForPresentKHR>(::vkGetDeviceProcAddr(m_logical_device, "vkWaitForPresentKHR"));
 }
 
 draw::swap_chain_t::~swap_chain_t()
 {
-	if (m_present_semaphore) ::vkDestroySemaphore(m_logical_device, m_present_semaphore, nullptr);
-	if (m_render_semaphore) ::vkDestroySemaphore(m_logical_device, m_render_semaphore, nullptr);
+	for (auto& frame : m_frames)
+	{
+		if (frame.m_fence) ::vkDestroyFence(m_logical_device, frame.m_fence, nullptr);
+		if (frame.m_present_semaphore) ::vkDestroySemaphore(m_logical_device, frame.m_present_semaphore, nullptr);
+		if (frame.m_render_semaphore) ::vkDestroySemaphore(m_logical_device, frame.m_render_semaphore, nullptr);
+	}
 
 	if (m_swap_chain) for (auto& image_view : m_image_views) ::vkDestroyImageView(m_logical_device, image_view.m_view, nullptr);
 	if (m_swap_chain) vkDestroySwapchainKHR(m_logical_device, m_swap_chain, nullptr);
@@ -42,10 +54,58 @@ auto draw::swap_chain_t::create_command_pools(std::uint32_t graphics_queue_index
 	vk_check_result(::vkCreateCommandPool(m_logical_device, &graphics_comman_pool_ci, nullptr, &m_graphics_command_pool));
 }
 
-auto draw::swap_chain_t::create_swap_chain(bool v_sync) -> void
+auto draw::swap_chain_t::select_present_mode(present_mode mode) -> VkPresentModeKHR
 {
-	auto swap_chain_ci = init::swap_chain_create_info(m_surface, v_sync, settings::color_format, settings::color_space, window::res_vk);
+	auto mode_count = std::uint32_t{ 0 };
+	vk_check_result(::vkGetPhysicalDeviceSurfacePresentModesKHR(m_physical_device, m_surface, &mode_count, nullptr));
+
+	auto modes = std::vector<VkPresentModeKHR>{ mode_count };
+	vk_check_result(::vkGetPhysicalDeviceSurfacePresentModesKHR(m_physical_device, m_surface, &mode_count, modes.data()));
+
+	auto supported = [&modes](VkPresentModeKHR mode) { return std::find(modes.begin(), modes.end(), mode) != modes.end(); };
+
+	// immediate falls back to mailbox, mailbox to fifo
+	if (mode == present_mode::immediate && supported(VK_PRESENT_MODE_IMMEDIATE_KHR))
+	{
+		m_present_mode = present_mode::immediate;
+		return VK_PRESENT_MODE_IMMEDIATE_KHR;
+	}
+
+	if (mode != present_mode::fifo && supported(VK_PRESENT_MODE_MAILBOX_KHR))
+	{
+		m_present_mode = present_mode::mailbox;
+		return VK_PRESENT_MODE_MAILBOX_KHR;
+	}
+
+	m_present_mode = present_mode::fifo;
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+auto draw::swap_chain_t::create_swap_chain(present_mode mode, VkExtent2D extent) -> void
+{
+	auto capabilities = VkSurfaceCapabilitiesKHR{ };
+	vk_check_result(::vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physical_device, m_surface, &capabilities));
+
+	// win32 surfaces report the client size, the requested one is only used when the surface leaves it open
+	m_extent = capabilities.currentExtent;
+	if (m_extent.width == ~0u)
+	{
+		m_extent.width = std::clamp(extent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+		m_extent.height = std::clamp(extent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+	}
+
+	auto vk_mode = this->select_present_mode(mode);
+
+	// mailbox needs a spare image to replace while one is shown and one is queued
+	auto image_count = std::max(m_present_mode == present_mode::mailbox ? std::uint32_t{ 3 } : std::uint32_t{ 2 }, capabilities.minImageCount);
+	if (capabilities.maxImageCount) image_count = std::min(image_count, capabilities.maxImageCount);
+
+	auto old_swap_chain = m_swap_chain;
+	auto swap_chain_ci = init::swap_chain_create_info(m_surface, vk_mode, image_count, settings::color_format, settings::color_space, m_extent, old_swap_chain);
 	vk_check_result(::vkCreateSwapchainKHR(m_logical_device, &swap_chain_ci, nullptr, &m_swap_chain));
+
+	if (old_swap_chain) vkDestroySwapchainKHR(m_logical_device, old_swap_chain, nullptr);
+	m_out_of_date = false;
 }
 
 auto draw::swap_chain_t::create_image_views() -> void
@@ -60,7 +120,7 @@ auto draw::swap_chain_t::create_image_views() -> void
 
 	for (auto i = std::uint32_t{ 0 }; i < image_count; i++)
 	{
-		auto image_view_ci = init::image_view_create_info(images.at(i), settings::color_format);
+		auto image_view_ci = init::image_view_create_info(images.at(i), settings::color_format, VK_IMAGE_ASPECT_COLOR_BIT);
 
 		m_image_views.at(i).m_image = images.at(i);
 		vk_check_result(::vkCreateImageView(m_logical_device, &image_view_ci, nullptr, &m_image_views.at(i).m_view));
@@ -69,38 +129,81 @@ auto draw::swap_chain_t::create_image_views() -> void
 
 auto draw::swap_chain_t::allocate_command_buffers() -> void
 {
-	m_graphics_command_buffers.resize(m_image_views.size());
-	auto graphics_command_buffer_ai = init::command_buffer_allocate_info(m_graphics_command_pool, m_graphics_command_buffers.size());
+	auto command_buffers = std::vector<VkCommandBuffer>{ m_frames.size() };
+	auto graphics_command_buffer_ai = init::command_buffer_allocate_info(m_graphics_command_pool, command_buffers.size());
+
+	vk_check_result(::vkAllocateCommandBuffers(m_logical_device, &graphics_command_buffer_ai, command_buffers.data()));
 
-	vk_check_result(::vkAllocateCommandBuffers(m_logical_device, &graphics_command_buffer_ai, m_graphics_command_buffers.data()));
+	for (auto i = std::uint32_t{ 0 }; i < m_frames.size(); i++)
+		m_frames.at(i).m_command_buffer = command_buffers.at(i);
 }
 
 auto draw::swap_chain_t::create_sync_primitives() -> void
 {
 	auto semaphore_ci = init::semaphore_create_info();
-	vk_check_result(::vkCreateSemaphore(m_logical_device, &semaphore_ci, nullptr, &m_present_semaphore));
-	vk_check_result(::vkCreateSemaphore(m_logical_device, &semaphore_ci, nullptr, &m_render_semaphore));
-
-	m_wait_fences.resize(m_graphics_command_buffers.size());
 	auto fence_ci = init::fence_create_info(VK_FENCE_CREATE_SIGNALED_BIT);
 
-	for (auto& fence : m_wait_fences)
-		vk_check_result(::vkCreateFence(m_logical_device, &fence_ci, nullptr, &fence))
+	for (auto& frame : m_frames)
+	{
+		vk_check_result(::vkCreateSemaphore(m_logical_device, &semaphore_ci, nullptr, &frame.m_present_semaphore));
+		vk_check_result(::vkCreateSemaphore(m_logical_device, &semaphore_ci, nullptr, &frame.m_render_semaphore));
+		vk_check_result(::vkCreateFence(m_logical_device, &fence_ci, nullptr, &frame.m_fence));
+	}
+
+	m_image_fences.resize(m_image_views.size(), nullptr);
 }
 
 auto draw::swap_chain_t::set_queue_info() -> void
 {
-	m_submit_info = init::submit_info(m_present_semaphore, settings::stage_mask, m_render_semaphore);
-	m_present_info = init::present_info(m_present_semaphore, m_swap_chain, m_buffer_index);
+	// semaphores are swapped in for the current frame before every submit / present
+	m_submit_info = init::submit_info(m_frames.at(0).m_present_semaphore, settings::stage_mask, m_frames.at(0).m_render_semaphore);
+	m_present_info = init::present_info(m_frames.at(0).m_render_semaphore, m_swap_chain, m_buffer_index);
+}
+
+auto draw::swap_chain_t::recreate(present_mode mode, VkExtent2D extent) -> void
+{
+	for (auto& image_view : m_image_views) ::vkDestroyImageView(m_logical_device, image_view.m_view, nullptr);
+
+	// the old swap chain is handed over, the presentation engine can reuse its resources
+	this->create_swap_chain(mode, extent);
+	this->create_image_views();
+
+	// no frame is in flight, the new images have not been rendered to yet
+	m_image_fences.assign(m_image_views.size(), nullptr);
+	m_present_id = 0;
+	m_unshown.clear();
+}
+
+auto draw::swap_chain_t::get_present_mode() -> present_mode
+{
+	return m_present_mode;
 }
 
+auto draw::swap_chain_t::get_extent() -> const VkExtent2D
+{
+	return m_extent;
+}
 
+auto draw::swap_chain_t::get_out_of_date() -> bool
+{
+	return m_out_of_date;
+}
 
 auto draw::swap_chain_t::get_buffer_index() -> const std::uint32_t
 {
 	return m_buffer_index;
 }
 
+auto draw::swap_chain_t::get_frame_index() -> const std::uint32_t
+{
+	return m_frame_index;
+}
+
+auto draw::swap_chain_t::get_frame_count() -> const std::uint32_t
+{
+	return static_cast<std::uint32_t>(m_frames.size());
+}
+
 auto draw::swap_chain_t::get_image_views() -> const std::vector<image_view_t>&
 {
 	return m_image_views;
@@ -108,12 +211,12 @@ auto draw::swap_chain_t::get_image_views() -> const std::vector<image_view_t>&
 
 auto draw::swap_chain_t::get_render_buffer() -> const VkCommandBuffer
 {
-	return m_graphics_command_buffers.at(m_buffer_index);
+	return m_frames.at(m_frame_index).m_command_buffer;
 }
 
 auto draw::swap_chain_t::get_render_fence() -> const VkFence
 {
-	return m_wait_fences.at(m_buffer_index);
+	return m_frames.at(m_frame_index).m_fence;
 }
 
 auto draw::swap_chain_t::get_command_pool() -> const VkCommandPool
@@ -121,22 +224,128 @@ auto draw::swap_chain_t::get_command_pool() -> const VkCommandPool
 	return m_graphics_command_pool;
 }
 
-auto draw::swap_chain_t::acquire_next_image() -> void
+auto draw::swap_chain_t::wait_frame() -> void
+{
+	::vkWaitForFences(m_logical_device, 1, &m_frames.at(m_frame_index).m_fence, 1, m_timeout);
+}
+
+auto draw::swap_chain_t::acquire_next_image() -> bool
+{
+	auto& frame = m_frames.at(m_frame_index);
+
+	// keeps the cpu at most one present ahead of the display, input is sampled closer to scan out
+	if (settings::present::pacing && m_wait_for_present && m_present_id)
+	{
+		if (m_wait_for_present(m_logical_device, m_swap_chain, m_present_id, m_timeout) == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			m_out_of_date = true;
+			return false;
+		}
+	}
+
+	// only wait for the frame that last used this slot, newer frames keep running
+	::vkWaitForFences(m_logical_device, 1, &frame.m_fence, 1, m_timeout);
+
+	// nothing was signaled, the frame fence stays signaled for the retry after recreating
+	auto result = ::vkAcquireNextImageKHR(m_logical_device, m_swap_chain, m_timeout, frame.m_present_semaphore, (VkFence)nullptr, &m_buffer_index);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		m_out_of_date = true;
+		return false;
+	}
+
+	// timeouts and not ready leave the semaphore unsignaled, skip the frame and retry
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		return false;
+
+	// still presentable, recreated after this frame
+	if (result == VK_SUBOPTIMAL_KHR)
+		m_out_of_date = true;
+
+	// images can be acquired out of order, make sure no older frame still renders to this one
+	if (auto& image_fence = m_image_fences.at(m_buffer_index); image_fence && image_fence != frame.m_fence)
+		::vkWaitForFences(m_logical_device, 1, &image_fence, 1, m_timeout);
+
+	m_image_fences.at(m_buffer_index) = frame.m_fence;
+	::vkResetFences(m_logical_device, 1, &frame.m_fence);
+
+	return true;
+}
+
+auto draw::swap_chain_t::queue_submit(VkQueue queue, VkSemaphore upload_semaphore, std::uint64_t upload_value) -> void
 {
-	::vkAcquireNextImageKHR(m_logical_device, m_swap_chain, m_timeout, m_present_semaphore, (VkFence)nullptr, &m_buffer_index);
+	auto& frame = m_frames.at(m_frame_index);
+
+	// the binary present semaphore ignores its value
+	auto wait_semaphores = std::array<VkSemaphore, 2>{frame.m_present_semaphore, upload_semaphore};
+	auto wait_stages = std::array<VkPipelineStageFlags, 2>{settings::stage_mask, settings::upload::wait_stage};
+	auto wait_values = std::array<std::uint64_t, 2>{0, upload_value};
+	auto timeline_si = VkTimelineSemaphoreSubmitInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO, nullptr, 2, wait_values.data(), 0, nullptr};
+
+	m_submit_info.pNext = upload_value ? &timeline_si : nullptr;
+	m_submit_info.waitSemaphoreCount = upload_value ? 2 : 1;
+	m_submit_info.pWaitSemaphores = wait_semaphores.data();
+	m_submit_info.pWaitDstStageMask = wait_stages.data();
+	m_submit_info.pSignalSemaphores = &frame.m_render_semaphore;
+	m_submit_info.pCommandBuffers = &frame.m_command_buffer;
+
+	::vkQueueSubmit(queue, 1, &m_submit_info, frame.m_fence);
 }
 
-auto draw::swap_chain_t::queue_submit(VkQueue queue) -> void
+auto draw::swap_chain_t::mailbox_damage(const std::vector<VkRectLayerKHR>& damage, std::uint64_t present_id) -> std::vector<VkRectLayerKHR>
 {
-	m_submit_info.pCommandBuffers = &m_graphics_command_buffers.at(m_buffer_index);
+	// without present ids nothing is ever known to be shown
+	if (!m_wait_for_present)
+		return {};
+
+	// a completed id means it or a later image was shown, everything up to it is on screen
+	auto shown = std::find_if(m_unshown.rbegin(), m_unshown.rend(), [&](const present_damage_t& present) {
+		return m_wait_for_present(m_logical_device, m_swap_chain, present.m_present_id, 0) == VK_SUCCESS;
+	});
+	m_unshown.erase(m_unshown.begin(), shown.base());
+
+	// the screen may still show an image older than any of the unshown ones
+	auto rects = damage;
+	auto full = damage.empty();
+	for (const auto& present : m_unshown)
+	{
+		full |= present.m_rects.empty();
+		rects.insert(rects.end(), present.m_rects.begin(), present.m_rects.end());
+	}
 
-	::vkQueueSubmit(queue, 1, &m_submit_info, m_wait_fences.at(m_buffer_index));
+	// a whole image present covers everything before it
+	if (full || rects.size() > settings::damage::max_rects)
+	{
+		m_unshown.assign(1, present_damage_t{present_id, {}});
+		return {};
+	}
+
+	m_unshown.push_back(present_damage_t{present_id, damage});
+	return rects;
 }
 
-auto draw::swap_chain_t::queue_present(VkQueue queue) -> void
+auto draw::swap_chain_t::queue_present(VkQueue queue, const std::vector<VkRectLayerKHR>& damage) -> void
 {
-	::vkQueuePresentKHR(queue, &m_present_info);
+	m_present_info.pWaitSemaphores = &m_frames.at(m_frame_index).m_render_semaphore;
+
+	// ids let acquire wait for this present to reach the display
+	auto present_id = ++m_present_id;
+	auto present_id_info = VkPresentIdKHR{VK_STRUCTURE_TYPE_PRESENT_ID_KHR, nullptr, 1, &present_id};
+	m_present_info.pNext = m_wait_for_present ? &present_id_info : nullptr;
 
-	::vkWaitForFences(m_logical_device, 1, &m_wait_fences.at(m_buffer_index), 1, m_timeout);
-	::vkResetFences(m_logical_device, 1, &m_wait_fences.at(m_buffer_index));
-}
\ No newline at end of file
+	// fifo and immediate show every image, mailbox may replace one before it is shown
+	const auto& rects = m_incremental_present && m_present_mode == present_mode::mailbox ? this->mailbox_damage(damage, present_id) : damage;
+
+	auto region = VkPresentRegionKHR{static_cast<std::uint32_t>(rects.size()), rects.data()};
+	auto regions = VkPresentRegionsKHR{VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR, m_present_info.pNext, 1, &region};
+	if (m_incremental_present && !rects.empty())
+		m_present_info.pNext = &regions;
+
+	auto result = ::vkQueuePresentKHR(queue, &m_present_info);
+	m_present_info.pNext = nullptr;
+
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		m_out_of_date = true;
+
+	m_frame_index = (m_frame_index + 1) % m_frames.size();
+}
@@ -10,35 +10,46 @@
 
 #include "../utils/containers.hxx"
 #include "../utils/constants.hxx"
+#include "../utils/settings.hxx"
 
 namespace draw
 {
 	class swap_chain_t
 	{
 		VkInstance m_instance{ nullptr };
+		VkPhysicalDevice m_physical_device{ nullptr };
 		VkDevice m_logical_device{ nullptr };
 
 		VkSurfaceKHR m_surface{ nullptr };
 		VkSwapchainKHR m_swap_chain{ nullptr };
+		present_mode m_present_mode{ present_mode::fifo }; // active mode after falling back
+		VkExtent2D m_extent{ }; // of the images, follows the surface
+		bool m_out_of_date{ false }; // no longer matches the surface, recreated before the next acquire
+
+		PFN_vkWaitForPresentKHR m_wait_for_present{ nullptr }; // set when present ids are enabled
+		bool m_incremental_present{ false }; // damage rects are handed to the presentation engine
+		std::uint64_t m_present_id{ 0 }; // of the last present
+		std::vector<present_damage_t> m_unshown{ }; // mailbox presents that may have been replaced, oldest first
 
 		VkCommandPool m_graphics_command_pool{ nullptr };
-		std::vector<VkCommandBuffer> m_graphics_command_buffers{ };
 		std::vector<image_view_t> m_image_views{ };
-		std::vector<VkFence> m_wait_fences{ };
 
-		VkSemaphore m_present_semaphore{ nullptr };
-		VkSemaphore m_render_semaphore{ nullptr };
+		std::vector<frame_t> m_frames{ }; // frames in flight
+		std::vector<VkFence> m_image_fences{ }; // fence of the frame last rendering to each image
 
 		std::uint64_t m_timeout{ std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::seconds(5)).count() };
 		std::uint32_t m_buffer_index{ 0 };
+		std::uint32_t m_frame_index{ 0 };
 
 		VkSubmitInfo m_submit_info{ };
 		VkPresentInfoKHR m_present_info{ };
 
 	public:
 
-		swap_chain_t(VkInstance instance, VkDevice logical_device,
-			const HWND window_handle, std::uint32_t graphics_queue_index);
+		swap_chain_t(VkInstance instance, VkPhysicalDevice physical_device, VkDevice logical_device,
+			const HWND window_handle, VkExtent2D extent, std::uint32_t graphics_queue_index, bool present_wait, bool incremental_present,
+			present_mode mode = settings::present::mode,
+			std::uint32_t frames_in_flight = settings::frames_in_flight);
 
 		~swap_chain_t();
 
@@ -48,7 +59,9 @@ namespace draw
 
 		auto create_command_pools(std::uint32_t graphics_queue_index) -> void;
 
-		auto create_swap_chain(bool v_sync = false) -> void;
+		auto select_present_mode(present_mode mode) -> VkPresentModeKHR;
+
+		auto create_swap_chain(present_mode mode, VkExtent2D extent) -> void;
 
 		auto create_image_views() -> void;
 
@@ -58,10 +71,26 @@ namespace draw
 
 		auto set_queue_info() -> void;
 
+		// a mailbox image only counts as shown once a later present id completed, until then its damage is carried forward
+		auto mailbox_damage(const std::vector<VkRectLayerKHR>& damage, std::uint64_t present_id) -> std::vector<VkRectLayerKHR>;
+
 	public:
 
+		// the device has to be idle, frame buffers over the old image views are invalid afterwards
+		auto recreate(present_mode mode, VkExtent2D extent) -> void;
+
+		auto get_present_mode() -> present_mode;
+
+		auto get_extent() -> const VkExtent2D;
+
+		auto get_out_of_date() -> bool;
+
 		auto get_buffer_index() -> const std::uint32_t;
 
+		auto get_frame_index() -> const std::uint32_t;
+
+		auto get_frame_count() -> const std::uint32_t;
+
 		auto get_image_views() -> const std::vector<image_view_t>&;
 
 		auto get_render_buffer() -> const VkCommandBuffer;
@@ -70,10 +99,16 @@ namespace draw
 
 		auto get_command_pool() -> const VkCommandPool;
 
-		auto acquire_next_image() -> void;
+		// the frame slot is free again, its ring space and queries can be reused
+		auto wait_frame() -> void;
+
+		// false when the swap chain is out of date and has to be recreated first
+		auto acquire_next_image() -> bool;
 
-		auto queue_submit(VkQueue queue) -> void;
+		// waits on the timeline semaphore of uploads when given a value
+		auto queue_submit(VkQueue queue, VkSemaphore upload_semaphore = nullptr, std::uint64_t upload_value = 0) -> void;
 
-		auto queue_present(VkQueue queue) -> void;
+		// pixels that changed since the last present, empty for the whole image
+		auto queue_present(VkQueue queue, const std::vector<VkRectLayerKHR>& damage = {}) -> void;
 	};
 }
@@ -0,0 +1,90 @@
+#include "task_graph.hxx"
+
+#include <algorithm>
+#include <iomanip>
+#include <thread>
+
+auto draw::task_graph_t::add(const char* name, std::function<void()> work, std::initializer_list<std::uint32_t> dependencies) -> std::uint32_t
+{
+	auto index = static_cast<std::uint32_t>(m_tasks.size());
+
+	auto task = graph_task_t{name, std::move(work)};
+	task.m_waiting = static_cast<std::uint32_t>(dependencies.size());
+	m_tasks.push_back(std::move(task));
+
+	for (auto dependency : dependencies)
+		m_tasks.at(dependency).m_dependents.push_back(index);
+
+	return index;
+}
+
+auto draw::task_graph_t::run(std::uint32_t thread_count) -> void
+{
+	m_start = std::chrono::steady_clock::now();
+	m_remaining = static_cast<std::uint32_t>(m_tasks.size());
+	m_thread_count = std::max(thread_count, std::uint32_t{1});
+
+	// tasks added first start first
+	for (auto i = m_remaining; i > 0; i--)
+		if (!m_tasks.at(i - 1).m_waiting) m_ready.push_back(i - 1);
+
+	// the calling thread is worker 0
+	auto threads = std::vector<std::thread>{};
+	for (auto i = std::uint32_t{1}; i < m_thread_count; i++)
+		threads.emplace_back(&task_graph_t::worker, this, i);
+
+	this->worker(0);
+
+	for (auto& thread : threads)
+		thread.join();
+
+	m_duration = this->elapsed();
+}
+
+auto draw::task_graph_t::worker(std::uint32_t thread_index) -> void
+{
+	auto lock = std::unique_lock{m_mutex};
+
+	for (;;)
+	{
+		m_condition.wait(lock, [this] { return !m_ready.empty() || !m_remaining; });
+		if (!m_remaining)
+			return;
+
+		auto& task = m_tasks.at(m_ready.back());
+		m_ready.pop_back();
+
+		lock.unlock();
+
+		task.m_thread = thread_index;
+		task.m_start = this->elapsed();
+		task.m_work();
+		task.m_end = this->elapsed();
+
+		lock.lock();
+
+		for (auto dependent : task.m_dependents)
+			if (!--m_tasks.at(dependent).m_waiting) m_ready.push_back(dependent);
+
+		m_remaining--;
+		m_condition.notify_all();
+	}
+}
+
+auto draw::task_graph_t::elapsed() -> std::float_t
+{
+	return std::chrono::duration<std::float_t, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+auto draw::task_graph_t::report(std::ostream& stream) -> void
+{
+	stream << std::fixed << std::setprecision(1);
+	stream << "startup took " << m_duration << " ms on " << m_thread_count << " threads" << std::endl;
+
+	for (const auto& task : m_tasks)
+	{
+		stream << "  " << std::left << std::setw(20) << task.m_name << std::right <<
+			std::setw(7) << task.m_start << " .. " << std::setw(7) << task.m_end << " ms  (" <<
+			std::setw(6) << task.m_end - task.m_start << " ms, thread " << task.m_thread << ")" << std::endl;
+	}
+}
\ No newline at end of file
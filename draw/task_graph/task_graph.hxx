@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "../utils/containers.hxx"
+
+namespace draw
+{
+	// runs tasks as soon as their dependencies finished, on a few threads joined before run returns
+	class task_graph_t
+	{
+		std::vector<graph_task_t> m_tasks{};
+		std::vector<std::uint32_t> m_ready{}; // next task at the back
+		std::uint32_t m_remaining{0};
+		std::uint32_t m_thread_count{0};
+
+		std::mutex m_mutex{};
+		std::condition_variable m_condition{};
+
+		std::chrono::steady_clock::time_point m_start{};
+		std::float_t m_duration{0.0f}; // ms
+
+	private:
+
+		auto worker(std::uint32_t thread_index) -> void;
+
+		auto elapsed() -> std::float_t;
+
+	public:
+
+		// dependencies are indices returned by earlier calls, which keeps the graph free of cycles
+		auto add(const char* name, std::function<void()> work, std::initializer_list<std::uint32_t> dependencies = {}) -> std::uint32_t;
+
+		auto run(std::uint32_t thread_count) -> void;
+
+		auto report(std::ostream& stream) -> void;
+	};
+}
\ No newline at end of file
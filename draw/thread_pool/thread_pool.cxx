@@ -0,0 +1,75 @@
+#include "thread_pool.hxx"
+
+#include <algorithm>
+
+draw::thread_pool_t::thread_pool_t(std::uint32_t thread_count)
+{
+	// the calling thread is worker 0
+	for (auto i = std::uint32_t{1}; i < std::max(thread_count, std::uint32_t{1}); i++)
+		m_threads.emplace_back(&thread_pool_t::worker, this, i);
+}
+
+draw::thread_pool_t::~thread_pool_t()
+{
+	{
+		auto lock = std::unique_lock{m_mutex};
+		m_stop = true;
+	}
+
+	m_condition.notify_all();
+
+	for (auto& thread : m_threads)
+		thread.join();
+}
+
+auto draw::thread_pool_t::worker(std::uint32_t thread_index) -> void
+{
+	auto lock = std::unique_lock{m_mutex};
+	auto generation = std::uint64_t{0};
+
+	for (;;)
+	{
+		m_condition.wait(lock, [&] { return m_stop || m_generation != generation; });
+		if (m_stop)
+			return;
+
+		generation = m_generation;
+		this->take_jobs(lock, thread_index);
+	}
+}
+
+auto draw::thread_pool_t::take_jobs(std::unique_lock<std::mutex>& lock, std::uint32_t thread_index) -> void
+{
+	for (; m_next < m_jobs; )
+	{
+		auto job = m_next++;
+
+		lock.unlock();
+		m_work(job, thread_index);
+		lock.lock();
+
+		if (++m_finished == m_jobs)
+			m_done.notify_all();
+	}
+}
+
+auto draw::thread_pool_t::get_thread_count() -> std::uint32_t
+{
+	return static_cast<std::uint32_t>(m_threads.size()) + 1;
+}
+
+auto draw::thread_pool_t::run(std::uint32_t job_count, std::function<void(std::uint32_t job, std::uint32_t worker)> work) -> void
+{
+	auto lock = std::unique_lock{m_mutex};
+
+	m_work = std::move(work);
+	m_jobs = job_count;
+	m_next = 0;
+	m_finished = 0;
+	m_generation++;
+
+	m_condition.notify_all();
+
+	this->take_jobs(lock, 0);
+	m_done.wait(lock, [this] { return m_finished == m_jobs; });
+}
\ No newline at end of file
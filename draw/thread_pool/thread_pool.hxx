@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace draw
+{
+	// threads kept alive between runs, the calling thread takes jobs as worker 0
+	class thread_pool_t
+	{
+		std::vector<std::thread> m_threads{};
+
+		std::function<void(std::uint32_t, std::uint32_t)> m_work{}; // job, worker
+		std::uint32_t m_jobs{0};
+		std::uint32_t m_next{0}; // job handed out next
+		std::uint32_t m_finished{0};
+		std::uint64_t m_generation{0}; // bumped by every run, wakes the workers
+		bool m_stop{false};
+
+		std::mutex m_mutex{};
+		std::condition_variable m_condition{};
+		std::condition_variable m_done{};
+
+	private:
+
+		auto worker(std::uint32_t thread_index) -> void;
+
+		auto take_jobs(std::unique_lock<std::mutex>& lock, std::uint32_t thread_index) -> void;
+
+	public:
+
+		thread_pool_t(std::uint32_t thread_count);
+
+		~thread_pool_t();
+
+		auto get_thread_count() -> std::uint32_t;
+
+		// returns once every job ran, jobs are handed out in order
+		auto run(std::uint32_t job_count, std::function<void(std::uint32_t job, std::uint32_t worker)> work) -> void;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "uploader.hxx"
+
+#include <cstring>
+
+#include "../utils/error.hxx"
+#include "../utils/settings.hxx"
+#include "../utils/init.hxx"
+
+draw::uploader_t::uploader_t(device_t* device)
+	: m_device{device}
+{
+	auto command_pool_ci = init::command_pool_create_info(m_device->get_transfer_queue_index(), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+	vk_check_result(::vkCreateCommandPool(m_device->get_device(), &command_pool_ci, nullptr, &m_command_pool));
+
+	auto semaphore_tci = VkSemaphoreTypeCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO, nullptr, VK_SEMAPHORE_TYPE_TIMELINE, 0};
+	auto semaphore_ci = init::semaphore_create_info();
+	semaphore_ci.pNext = &semaphore_tci;
+	vk_check_result(::vkCreateSemaphore(m_device->get_device(), &semaphore_ci, nullptr, &m_semaphore));
+
+	m_staging.m_size = settings::upload::staging_size;
+
+	auto buffer_ci = init::buffer_create_info(m_staging.m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+	vk_check_result(::vkCreateBuffer(m_device->get_device(), &buffer_ci, nullptr, &m_staging.m_buffer));
+	m_staging.m_allocation = m_device->allocate_buffer_memory(m_staging.m_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+draw::uploader_t::~uploader_t()
+{
+	// nothing may still be reading the staging memory
+	if (m_semaphore) this->wait(this->submit());
+	this->reclaim();
+
+	if (m_staging.m_buffer) ::vkDestroyBuffer(m_device->get_device(), m_staging.m_buffer, nullptr);
+	if (m_staging.m_allocation.m_memory) m_device->free_memory(m_staging.m_allocation);
+
+	if (m_semaphore) ::vkDestroySemaphore(m_device->get_device(), m_semaphore, nullptr);
+	if (m_command_pool) ::vkDestroyCommandPool(m_device->get_device(), m_command_pool, nullptr);
+}
+
+auto draw::uploader_t::reclaim() -> void
+{
+	auto completed = std::uint64_t{0};
+	vk_check_result(::vkGetSemaphoreCounterValue(m_device->get_device(), m_semaphore, &completed));
+
+	while (!m_batches.empty() && m_batches.front().m_value <= completed)
+	{
+		auto& batch = m_batches.front();
+		m_tail = batch.m_head;
+
+		for (auto& staging : batch.m_oversized)
+		{
+			::vkDestroyBuffer(m_device->get_device(), staging.m_buffer, nullptr);
+			m_device->free_memory(staging.m_allocation);
+		}
+
+		m_command_buffers.push_back(batch.m_command_buffer);
+		m_batches.erase(m_batches.begin());
+	}
+}
+
+auto draw::uploader_t::fits(VkDeviceSize offset, VkDeviceSize size) -> bool
+{
+	if (offset + size > m_staging.m_size)
+		return false;
+
+	// bytes from the tail up to the head are in use, wrapping around the end of the ring
+	if (m_tail == m_head)
+		return true;
+
+	if (m_tail < m_head)
+		return offset >= m_head || offset + size < m_tail;
+
+	return offset >= m_head && offset + size < m_tail;
+}
+
+auto draw::uploader_t::stage(const void* data, VkDeviceSize size) -> staging_range_t
+{
+	// too large for the ring, freed along with its batch
+	if (size > m_staging.m_size / 2)
+	{
+		auto staging = memory_buffer_t{};
+		staging.m_size = size;
+
+		auto buffer_ci = init::buffer_create_info(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+		vk_check_result(::vkCreateBuffer(m_device->get_device(), &buffer_ci, nullptr, &staging.m_buffer));
+		staging.m_allocation = m_device->allocate_buffer_memory(staging.m_buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memory_strategy::linear);
+
+		std::memcpy(staging.m_allocation.m_mapped, data, size);
+		m_recording.m_oversized.push_back(staging);
+
+		return staging_range_t{staging.m_buffer, 0};
+	}
+
+	this->reclaim();
+
+	for (;;)
+	{
+		if (m_tail == m_head) m_tail = m_head = 0; // idle, start over
+
+		auto offset = (m_head + settings::upload::alignment - 1) / settings::upload::alignment * settings::upload::alignment;
+		if (!this->fits(offset, size)) offset = 0; // wrap around, the end of the ring stays unused this round
+
+		if (this->fits(offset, size))
+		{
+			std::memcpy(static_cast<std::uint8_t*>(m_staging.m_allocation.m_mapped) + offset, data, size);
+			m_head = offset + size;
+
+			return staging_range_t{m_staging.m_buffer, offset};
+		}
+
+		// full, wait for the oldest copies to finish
+		if (m_batches.empty()) this->submit();
+		this->wait(m_batches.front().m_value);
+		this->reclaim();
+	}
+}
+
+auto draw::uploader_t::record() -> VkCommandBuffer
+{
+	if (m_recording.m_command_buffer)
+		return m_recording.m_command_buffer;
+
+	if (m_command_buffers.empty())
+	{
+		auto command_buffer_ai = init::command_buffer_allocate_info(m_command_pool, 1);
+		vk_check_result(::vkAllocateCommandBuffers(m_device->get_device(), &command_buffer_ai, &m_recording.m_command_buffer));
+	}
+	else
+	{
+		m_recording.m_command_buffer = m_command_buffers.back();
+		m_command_buffers.pop_back();
+	}
+
+	auto command_buffer_bi = init::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+	vk_check_result(::vkBeginCommandBuffer(m_recording.m_command_buffer, &command_buffer_bi));
+
+	return m_recording.m_command_buffer;
+}
+
+auto draw::uploader_t::upload_buffer(VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size) -> void
+{
+	auto staging = this->stage(data, size);
+	auto command_buffer = this->record();
+
+	auto buffer_copy = init::buffer_copy(size);
+	buffer_copy.srcOffset = staging.m_offset;
+	buffer_copy.dstOffset = dst_offset;
+	::vkCmdCopyBuffer(command_buffer, staging.m_buffer, dst, 1, &buffer_copy);
+}
+
+auto draw::uploader_t::upload_image(VkImage dst, VkExtent2D extent, const void* data, VkDeviceSize size) -> void
+{
+	auto staging = this->stage(data, size);
+	auto command_buffer = this->record();
+
+	auto image_sr = init::image_subresource_range(VK_IMAGE_ASPECT_COLOR_BIT);
+	auto transfer_mb = init::image_memory_barier(VkAccessFlags{0}, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, dst, image_sr);
+	::vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &transfer_mb);
+
+	auto buffer_ic = init::buffer_image_copy(extent);
+	buffer_ic.bufferOffset = staging.m_offset;
+	::vkCmdCopyBufferToImage(command_buffer, staging.m_buffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &buffer_ic);
+
+	// the timeline wait makes the copy visible, the barrier only changes layout and owner
+	auto release_mb = init::image_memory_barier(VK_ACCESS_TRANSFER_WRITE_BIT, VkAccessFlags{0},
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, dst, image_sr);
+
+	if (m_device->get_transfer_queue_index() != m_device->get_graphics_queue_index())
+	{
+		release_mb.srcQueueFamilyIndex = m_device->get_transfer_queue_index();
+		release_mb.dstQueueFamilyIndex = m_device->get_graphics_queue_index();
+
+		// recorded again on the graphics queue by acquire()
+		auto acquire_mb = release_mb;
+		acquire_mb.srcAccessMask = VkAccessFlags{0};
+		acquire_mb.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		m_image_acquires.push_back(acquire_mb);
+	}
+
+	::vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &release_mb);
+}
+
+auto draw::uploader_t::copy_buffer(VkBuffer src, VkBuffer dst, VkDeviceSize size) -> void
+{
+	auto command_buffer = this->record();
+
+	// earlier uploads may still be writing src
+	auto memory_b = init::memory_barrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	::vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_b, 0, nullptr, 0, nullptr);
+
+	auto buffer_copy = init::buffer_copy(size);
+	::vkCmdCopyBuffer(command_buffer, src, dst, 1, &buffer_copy);
+}
+
+auto draw::uploader_t::submit() -> std::uint64_t
+{
+	if (!m_recording.m_command_buffer)
+		return m_submitted;
+
+	vk_check_result(::vkEndCommandBuffer(m_recording.m_command_buffer));
+
+	m_recording.m_value = ++m_submitted;
+	m_recording.m_head = m_head;
+
+	auto timeline_si = VkTimelineSemaphoreSubmitInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO, nullptr, 0, nullptr, 1, &m_recording.m_value};
+
+	auto submit_info = VkSubmitInfo{ };
+	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_info.pNext = &timeline_si;
+	submit_info.commandBufferCount = std::uint32_t{1};
+	submit_info.pCommandBuffers = &m_recording.m_command_buffer;
+	submit_info.signalSemaphoreCount = std::uint32_t{1};
+	submit_info.pSignalSemaphores = &m_semaphore;
+	vk_check_result(::vkQueueSubmit(m_device->get_transfer_queue(), 1, &submit_info, nullptr));
+
+	m_batches.push_back(std::move(m_recording));
+	m_recording = upload_batch_t{};
+
+	return m_submitted;
+}
+
+auto draw::uploader_t::wait(std::uint64_t value) -> void
+{
+	if (!value)
+		return;
+
+	auto semaphore_wi = VkSemaphoreWaitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO, nullptr, 0, 1, &m_semaphore, &value};
+	vk_check_result(::vkWaitSemaphores(m_device->get_device(), &semaphore_wi, UINT64_MAX));
+}
+
+auto draw::uploader_t::acquire(VkCommandBuffer command_buffer) -> std::uint64_t
+{
+	auto value = this->submit();
+
+	if (!m_image_acquires.empty())
+	{
+		::vkCmdPipelineBarrier(command_buffer, settings::upload::wait_stage, settings::upload::wait_stage, 0, 0, nullptr, 0, nullptr,
+			static_cast<std::uint32_t>(m_image_acquires.size()), m_image_acquires.data());
+		m_image_acquires.clear();
+	}
+
+	// finished batches give back their staging space and command buffers
+	this->reclaim();
+
+	return value;
+}
+
+auto draw::uploader_t::get_semaphore() -> const VkSemaphore
+{
+	return m_semaphore;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#define VK_USE_PLATFORM_WIN32_KHR
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "../device/device.hxx"
+#include "../utils/containers.hxx"
+
+namespace draw
+{
+	// streams data into device local resources on the transfer queue, the graphics queue waits on a timeline semaphore
+	class uploader_t
+	{
+		device_t* m_device{nullptr};
+
+		VkCommandPool m_command_pool{nullptr}; // transfer family
+		std::vector<VkCommandBuffer> m_command_buffers{}; // recycled from finished batches
+
+		VkSemaphore m_semaphore{nullptr}; // timeline, counts submitted batches
+		std::uint64_t m_submitted{0}; // value of the last submitted batch
+
+		memory_buffer_t m_staging{}; // persistently mapped ring
+		VkDeviceSize m_head{0}; // next byte written
+		VkDeviceSize m_tail{0}; // oldest byte still read by the gpu, equal to the head when idle
+
+		upload_batch_t m_recording{}; // no command buffer while nothing is recorded
+		std::vector<upload_batch_t> m_batches{}; // submitted, oldest first
+
+		std::vector<VkImageMemoryBarrier> m_image_acquires{}; // graphics side of ownership transfers
+
+	public:
+
+		uploader_t(device_t* device);
+
+		~uploader_t();
+
+	private:
+
+		auto reclaim() -> void;
+
+		auto fits(VkDeviceSize offset, VkDeviceSize size) -> bool;
+
+		auto stage(const void* data, VkDeviceSize size) -> staging_range_t;
+
+		auto record() -> VkCommandBuffer;
+
+	public:
+
+		// dst has to be shared concurrently by the graphics and transfer families
+		auto upload_buffer(VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size) -> void;
+
+		// leaves dst in shader read only layout, owned by the graphics family once acquired
+		auto upload_image(VkImage dst, VkExtent2D extent, const void* data, VkDeviceSize size) -> void;
+
+		auto copy_buffer(VkBuffer src, VkBuffer dst, VkDeviceSize size) -> void;
+
+		// returns the timeline value signaled once every upload so far finished
+		auto submit() -> std::uint64_t;
+
+		auto wait(std::uint64_t value) -> void;
+
+		// records the graphics side of ownership transfers, the command buffer's submit has to wait on the returned value
+		auto acquire(VkCommandBuffer command_buffer) -> std::uint64_t;
+
+		auto get_semaphore() -> const VkSemaphore;
+	};
+}
\ No newline at end of file
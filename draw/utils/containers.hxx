@@ -5,6 +5,9 @@
 #include <vector>
 #include <array>
 #include <string>
+#include <span>
+#include <functional>
+#include <cstddef>
 
 #include "../../utils/containers.hxx"
 #include "../fonts/stb_font_consolas_24_latin1.inl"
@@ -15,30 +18,231 @@ struct image_view_t // swap chain image
 	VkImageView m_view;
 };
 
-struct memory_buffer_t
+struct frame_t // resources of a single frame in flight
+{
+	VkCommandBuffer m_command_buffer;
+	VkSemaphore m_present_semaphore; // signaled once the acquired image can be rendered to
+	VkSemaphore m_render_semaphore; // signaled once rendering finished, waited on by present
+	VkFence m_fence; // signaled once the gpu is done with the frame
+};
+
+struct present_damage_t // a mailbox present not yet known to have reached the screen
+{
+	std::uint64_t m_present_id;
+	std::vector<VkRectLayerKHR> m_rects; // empty is the whole image
+};
+
+enum class present_mode : std::uint32_t // falls back towards fifo, the only mode every driver has
+{
+	fifo, // v-sync, never tears, queues up to the image count
+	mailbox, // newest frame replaces the queued one, no tearing and no cap
+	immediate // presents right away, may tear
+};
+
+enum class memory_strategy : std::uint32_t
+{
+	free_list, // long lived, first fit, freed ranges merge with their neighbours
+	linear // short lived, the head rewinds once every allocation of the block is freed
+};
+
+struct memory_range_t
+{
+	VkDeviceSize m_offset;
+	VkDeviceSize m_size;
+};
+
+struct memory_block_t // one vkAllocateMemory shared by many resources
 {
 	VkDeviceMemory m_memory;
+	VkDeviceSize m_size;
+	std::uint8_t* m_mapped; // the whole block, mapped once when host visible
+	std::uint32_t m_type;
+	memory_strategy m_strategy;
+	bool m_optimal; // holds images, kept apart from buffers when the granularity could split a page
+	VkDeviceSize m_used;
+	VkDeviceSize m_head; // linear only
+	std::uint32_t m_allocations;
+	std::vector<memory_range_t> m_free; // free list only, sorted by offset
+};
+
+struct memory_allocation_t
+{
+	VkDeviceMemory m_memory;
+	VkDeviceSize m_offset;
+	VkDeviceSize m_size;
+	void* m_mapped; // null unless host visible
+	std::uint32_t m_block; // ~0u for a dedicated allocation
+};
+
+struct memory_stats_t
+{
+	VkDeviceSize m_used; // handed out to resources
+	VkDeviceSize m_reserved; // allocated from the driver
+	std::uint32_t m_allocations; // live vkAllocateMemory calls
+	std::float_t m_fragmentation; // 0 while every block has its free space in one range, towards 1 as it splits up
+};
+
+struct memory_buffer_t
+{
+	memory_allocation_t m_allocation;
 	VkBuffer m_buffer;
 	std::size_t m_size;
 };
 
+struct graph_task_t // startup step, run once everything it depends on finished
+{
+	const char* m_name;
+	std::function<void()> m_work;
+	std::vector<std::uint32_t> m_dependents{}; // released when this task finishes
+	std::uint32_t m_waiting{0}; // unfinished dependencies
+	std::uint32_t m_thread{0}; // worker it ran on, 0 is the calling thread
+	std::float_t m_start{0.0f}; // ms since the graph started
+	std::float_t m_end{0.0f};
+};
+
+struct staging_range_t // where an upload was copied to before the transfer queue reads it
+{
+	VkBuffer m_buffer;
+	VkDeviceSize m_offset;
+};
+
+struct upload_batch_t // copies submitted to the transfer queue together
+{
+	VkCommandBuffer m_command_buffer;
+	std::uint64_t m_value; // timeline value signaled once the copies finished
+	VkDeviceSize m_head; // staging ring head after the batch, becomes the tail once it finished
+	std::vector<memory_buffer_t> m_oversized; // staging buffers of uploads larger than the ring
+};
+
+struct pipeline_cache_header_t // in front of the driver's data in the cache file
+{
+	std::uint32_t m_magic;
+	std::uint32_t m_vendor;
+	std::uint32_t m_device;
+	std::uint32_t m_driver_version;
+	std::array<std::uint8_t, VK_UUID_SIZE> m_uuid; // pipelineCacheUUID
+	std::uint64_t m_size; // bytes following the header
+};
+
+struct layer_image_t // offscreen color target of a cached layer
+{
+	VkImage m_image;
+	memory_allocation_t m_allocation;
+	VkImageView m_view;
+	VkFramebuffer m_frame_buffer;
+	VkDescriptorSet m_set; // sampled by the composite pipeline
+};
+
+struct ring_allocation_t // sub-allocation of a ring buffer
+{
+	VkDeviceSize m_offset;
+	void* m_data;
+};
+
 struct vertex_input_t
 {
 	VkFormat m_format;
 	std::size_t m_offset;
 };
 
-struct pipeline_setting_t
+// attribute format a shader reads a member type as
+template<typename T>
+inline constexpr auto vertex_format = VkFormat{VK_FORMAT_UNDEFINED};
+
+template<> inline constexpr auto vertex_format<std::float_t> = VkFormat{VK_FORMAT_R32_SFLOAT};
+template<> inline constexpr auto vertex_format<std::uint32_t> = VkFormat{VK_FORMAT_R32_UINT};
+template<> inline constexpr auto vertex_format<vec2_t<std::float_t>> = VkFormat{VK_FORMAT_R32G32_SFLOAT};
+template<> inline constexpr auto vertex_format<std::array<std::float_t, 4>> = VkFormat{VK_FORMAT_R32G32B32A32_SFLOAT};
+template<> inline constexpr auto vertex_format<color_t> = VkFormat{VK_FORMAT_R8G8B8A8_UNORM};
+
+template<typename M>
+consteval auto vertex_attribute(std::size_t offset) -> vertex_input_t
+{
+	static_assert(vertex_format<M> != VK_FORMAT_UNDEFINED, "member type has no vertex_format");
+	return vertex_input_t{vertex_format<M>, offset};
+}
+
+// format and offset of a vertex struct member, both known at compile time
+#define vertex_member(type, member) vertex_attribute<decltype(type::member)>(offsetof(type, member))
+
+// specialized next to every struct bound as a vertex stream, shader locations follow the order of inputs
+template<typename T>
+struct vertex_layout_t;
+
+enum class stencil_mode : std::uint32_t
+{
+	none,
+	winding, // color writes off, front faces increment and back faces decrement
+	cover // draws where the stencil is non zero and resets it
+};
+
+enum class depth_mode : std::uint32_t // depth comes from submission order, later primitives are closer
+{
+	none,
+	test,
+	test_write // opaque geometry, lets the early depth test reject what it covers
+};
+
+enum class blend_mode : std::uint32_t // alpha always accumulates as src + dst * (1 - src alpha)
+{
+	straight,
+	premultiplied // cached layers, their colors were already scaled by alpha when drawn
+};
+
+struct vertex_binding_t // shader locations continue across bindings
 {
-	std::string m_vertex;
-	std::string m_fragment;
 	std::size_t m_stride;
-	std::vector<vertex_input_t> m_vert_input;
+	VkVertexInputRate m_input_rate;
+	std::span<const vertex_input_t> m_inputs;
+};
+
+// one binding per stream in order, laid out from each struct's vertex_layout_t
+template<typename... T>
+inline constexpr auto vertex_bindings = std::array<vertex_binding_t, sizeof...(T)>{
+	vertex_binding_t{sizeof(T), vertex_layout_t<T>::input_rate, vertex_layout_t<T>::inputs}...
+};
+
+template<typename T>
+struct batch_t // one vertex or instance stream of a frame, copied into the ring as a whole
+{
+	VkDeviceSize m_offset;
+	std::vector<T> m_data;
+};
+
+struct pipeline_setting_t
+{
+	std::span<const std::uint32_t> m_vertex; // spir-v embedded through shaders.hxx
+	std::span<const std::uint32_t> m_fragment;
+	std::span<const vertex_binding_t> m_bindings; // vertex_bindings of the streams
 	VkPrimitiveTopology m_topology;
 	VkPolygonMode m_polygon_mode;
+	std::uint32_t m_push_constant_size; // vertex stage, 0 for none
+	stencil_mode m_stencil{stencil_mode::none};
+	depth_mode m_depth{depth_mode::none};
+	blend_mode m_blend{blend_mode::straight};
+	bool m_sampled{false}; // binding 0 is an image bound per draw instead of a uniform buffer
+};
+
+struct shader_modules_t // owned by the renderer, shared between pipelines using the same spir-v
+{
+	VkShaderModule m_vertex;
+	VkShaderModule m_fragment;
+};
+
+struct transform_t // 2d affine applied to pixel coordinates, x' = a x + b y + tx, y' = c x + d y + ty
+{
+	std::float_t m_a{1.0f}, m_b{0.0f};
+	std::float_t m_c{0.0f}, m_d{1.0f};
+	vec2_t<std::float_t> m_translation{0.0f, 0.0f};
+};
+
+struct push_constants_t // pixels to clip space, projection * transform, shared by every pipeline
+{
+	std::array<std::float_t, 4> m_row_x; // clip x = dot(row_x.xyz, vec3(pos, 1))
+	std::array<std::float_t, 4> m_row_y;
 };
 
-// VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_POLYGON_MODE_FILL
+// VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_POLYGON_MODE_FILL, pixel coordinates
 struct vertex_t
 {
 	vec2_t<std::float_t> m_pos;
@@ -53,59 +257,349 @@ struct vertex_t
 	vertex_t(std::float_t x, std::float_t y, color_t color)
 		: m_pos{x, y},
 		m_col{color} {	}
+};
+
+template<>
+struct vertex_layout_t<vertex_t>
+{
+	static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_VERTEX;
+	static constexpr auto inputs = std::array<vertex_input_t, 2>{vertex_member(vertex_t, m_pos), vertex_member(vertex_t, m_col)};
+};
+
+template<>
+struct vertex_layout_t<std::float_t> // per vertex depth, second stream of meshes
+{
+	static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_VERTEX;
+	static constexpr auto inputs = std::array<vertex_input_t, 1>{vertex_attribute<std::float_t>(0)};
+};
+
+struct mesh_draw_t // a single mesh call inside the batch, what gpu culling sees of meshes
+{
+	std::array<std::float_t, 4> m_bounds; // min x, min y, max x, max y in pixels
+	std::uint32_t m_first_index;
+	std::uint32_t m_index_count;
+	std::array<std::uint32_t, 2> m_pad;
+};
+
+struct mesh_buffer_t // every mesh of a frame, batched into one indexed triangle list
+{
+	VkPipeline m_pipeline;
+	VkDeviceSize m_index_offset;
+	VkDeviceSize m_draw_offset;
+	batch_t<vertex_t> m_vertices;
+	batch_t<std::float_t> m_depths; // one per vertex, second vertex stream
+	std::vector<std::uint32_t> m_indices; // reordered while uploaded
+	std::vector<mesh_draw_t> m_opaque; // every vertex fully opaque, drawn first and front to back
+	std::vector<mesh_draw_t> m_draws; // translucent, drawn through the sorted command stream
+};
+
+enum class fill_rule : std::uint32_t
+{
+	non_zero,
+	even_odd
+};
+
+struct polygon_draw_t // one stencil winding pass and its cover quad
+{
+	std::uint32_t m_first_index;
+	std::uint32_t m_index_count;
+	fill_rule m_rule;
+};
+
+// VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_POLYGON_MODE_FILL, one instance per polygon
+struct polygon_cover_t
+{
+	std::array<std::float_t, 4> m_bounds; // min x, min y, max x, max y in pixels
+	color_t m_col;
+	std::float_t m_depth;
+};
+
+template<>
+struct vertex_layout_t<polygon_cover_t>
+{
+	static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	static constexpr auto inputs = std::array<vertex_input_t, 3>{
+		vertex_member(polygon_cover_t, m_bounds),
+		vertex_member(polygon_cover_t, m_col),
+		vertex_member(polygon_cover_t, m_depth)
+	};
+};
+
+struct polygon_buffer_t // concave and self intersecting polygons, filled with stencil then cover
+{
+	batch_t<vertex_t> m_vertices;
+	batch_t<std::uint32_t> m_indices; // triangle fan around each polygon's first point
+	batch_t<polygon_cover_t> m_covers;
+	std::vector<polygon_draw_t> m_draws;
+};
 
-	auto to_absolute(vec2_t<std::int32_t> res) -> vertex_t
-	{
-		m_pos.m_x = std::float_t{-1.0f + (static_cast<std::float_t>(this->m_pos.m_x) / static_cast<std::float_t>(res.m_x)) * 2.0f};
-		m_pos.m_y = std::float_t{-1.0f + (static_cast<std::float_t>(this->m_pos.m_y) / static_cast<std::float_t>(res.m_y)) * 2.0f};
+struct mesh_handle_t // retained mesh, returned by scene_t::register_mesh
+{
+	std::uint32_t m_index{~0u};
+};
 
-		return *this;
-	}
+struct mesh_range_t // where a retained mesh lives in the mesh pool
+{
+	std::uint32_t m_first_index;
+	std::uint32_t m_index_count;
+	std::int32_t m_vertex_offset;
+};
+
+struct mesh_instance_t // per instance data of a retained mesh
+{
+	transform_t m_transform; // mesh pixels to screen pixels
+	color_t m_col; // multiplied with the vertex colors
+	std::float_t m_depth;
+};
+
+template<>
+struct vertex_layout_t<mesh_instance_t>
+{
+	static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	static constexpr auto inputs = std::array<vertex_input_t, 4>{
+		vertex_input_t{VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(mesh_instance_t, m_transform) + offsetof(transform_t, m_a)}, // a, b, c, d
+		vertex_input_t{vertex_format<vec2_t<std::float_t>>, offsetof(mesh_instance_t, m_transform) + offsetof(transform_t, m_translation)},
+		vertex_member(mesh_instance_t, m_col),
+		vertex_member(mesh_instance_t, m_depth)
+	};
 };
 
-struct mesh_info_t
+struct retained_draw_t // consecutive instances of the same mesh, one instanced draw
 {
-	std::vector<vertex_t> m_vertices;
+	mesh_handle_t m_mesh;
+	std::uint32_t m_first_instance;
+	std::uint32_t m_instance_count;
 };
 
-struct mesh_buffer_t
+struct retained_buffer_t
 {
 	VkPipeline m_pipeline;
-	memory_buffer_t m_vertex_buffer;
-	std::vector<mesh_info_t> m_info;
+	batch_t<mesh_instance_t> m_instances;
+	std::vector<retained_draw_t> m_draws;
 };
 
-// VK_PRIMITIVE_TOPOLOGY_LINE_LIST, VK_POLYGON_MODE_LINE
-struct line_info_t
+enum class line_cap : std::uint32_t
 {
-	std::vector<vertex_t> m_vertices;
-	std::float_t m_width;
+	butt, // ends exactly at the end points
+	square, // extended by half the width
+	round
+};
+
+enum class edge_mode : std::uint32_t // per primitive, feathering costs a ring of vertices or a wider quad
+{
+	aliased,
+	feathered // coverage fades to zero over settings::antialias::feather pixels
+};
+
+// VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_POLYGON_MODE_FILL, one instance per segment
+struct line_instance_t
+{
+	vec2_t<std::float_t> m_from; // pixels
+	vec2_t<std::float_t> m_to;
+	color_t m_from_col;
+	color_t m_to_col;
+	std::float_t m_width; // pixels
+	line_cap m_cap;
+	std::float_t m_depth;
+	std::float_t m_feather; // pixels, 0 for a hard edge
+};
+
+template<> inline constexpr auto vertex_format<line_cap> = vertex_format<std::uint32_t>;
+
+template<>
+struct vertex_layout_t<line_instance_t>
+{
+	static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	static constexpr auto inputs = std::array<vertex_input_t, 8>{
+		vertex_member(line_instance_t, m_from),
+		vertex_member(line_instance_t, m_to),
+		vertex_member(line_instance_t, m_from_col),
+		vertex_member(line_instance_t, m_to_col),
+		vertex_member(line_instance_t, m_width),
+		vertex_member(line_instance_t, m_cap),
+		vertex_member(line_instance_t, m_depth),
+		vertex_member(line_instance_t, m_feather)
+	};
 };
 
 struct line_buffer_t
 {
 	VkPipeline m_pipeline;
-	memory_buffer_t m_vertex_buffer;
-	std::vector<line_info_t> m_info;
+	batch_t<line_instance_t> m_lines;
 };
 
-// VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_POLYGON_MODE_FILL
-struct text_vertex_t
+// VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_POLYGON_MODE_FILL, one instance per shape
+struct shape_instance_t // rounded box evaluated as a signed distance field in shape.frag
 {
-	vec2_t<std::float_t> m_pos;
-	vec2_t<std::float_t> m_uv;
+	vec2_t<std::float_t> m_center; // pixels
+	vec2_t<std::float_t> m_half_size;
+	std::float_t m_corner; // corner radius, half_size for circles
+	std::float_t m_thickness; // 0 for filled, outline width otherwise
+	std::float_t m_arc_start; // radians, clockwise from +x
+	std::float_t m_arc_sweep; // 2 pi for closed shapes
 	color_t m_col;
+	std::float_t m_depth;
 };
 
-struct text_info_t
+template<>
+struct vertex_layout_t<shape_instance_t>
 {
-	std::vector<text_vertex_t> m_vertices;
+	static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	static constexpr auto inputs = std::array<vertex_input_t, 8>{
+		vertex_member(shape_instance_t, m_center),
+		vertex_member(shape_instance_t, m_half_size),
+		vertex_member(shape_instance_t, m_corner),
+		vertex_member(shape_instance_t, m_thickness),
+		vertex_member(shape_instance_t, m_arc_start),
+		vertex_member(shape_instance_t, m_arc_sweep),
+		vertex_member(shape_instance_t, m_col),
+		vertex_member(shape_instance_t, m_depth)
+	};
+};
+
+struct shape_buffer_t
+{
+	VkPipeline m_pipeline;
+	batch_t<shape_instance_t> m_shapes;
+};
+
+enum class cull_kind : std::uint32_t // primitive layouts cull.comp knows how to bound
+{
+	mesh,
+	line,
+	shape,
+	glyph
+};
+
+struct cull_stream_t // one primitive stream of the current frame, offsets into the cull buffer
+{
+	cull_kind m_kind;
+	std::array<std::float_t, 4> m_clip; // clip space min x, min y, max x, max y
+	std::uint32_t m_count; // primitives uploaded
+	std::uint32_t m_stride; // bytes per primitive
+	VkDeviceSize m_input_offset; // ring buffer
+	VkDeviceSize m_output_offset; // surviving primitives, or draw commands for meshes
+	VkDeviceSize m_scratch_offset; // one visible count per workgroup
+	VkDeviceSize m_command_offset; // indirect command, or the draw count for meshes
+};
+
+struct cull_constants_t
+{
+	push_constants_t m_projection;
+	std::array<std::float_t, 4> m_clip; // clip space min x, min y, max x, max y
+	std::array<std::float_t, 4> m_glyph_box; // settings::font::glyph_box
+	cull_kind m_kind;
+	std::uint32_t m_count;
+	std::uint32_t m_stride; // in words from here on
+	std::uint32_t m_input_offset;
+	std::uint32_t m_output_offset;
+	std::uint32_t m_scratch_offset;
+	std::uint32_t m_command_offset;
+	std::uint32_t m_pass; // count, scan, compact
+};
+
+struct glyph_metrics_t // std140 element of the glyph metrics uniform buffer
+{
+	std::array<std::float_t, 4> m_rect; // x0, y0, x1, y1 in font pixels
+	std::array<std::float_t, 4> m_uv; // s0, t0, s1, t1
+};
+
+// VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_POLYGON_MODE_FILL, one instance per glyph
+struct glyph_instance_t
+{
+	vec2_t<std::float_t> m_pos; // pixels
+	std::float_t m_scale; // screen pixels per font pixel
+	std::uint32_t m_glyph; // index into the glyph metrics
+	color_t m_col;
+	std::float_t m_depth;
+};
+
+template<>
+struct vertex_layout_t<glyph_instance_t>
+{
+	static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	static constexpr auto inputs = std::array<vertex_input_t, 5>{
+		vertex_member(glyph_instance_t, m_pos),
+		vertex_member(glyph_instance_t, m_scale),
+		vertex_member(glyph_instance_t, m_glyph),
+		vertex_member(glyph_instance_t, m_col),
+		vertex_member(glyph_instance_t, m_depth)
+	};
 };
 
 struct text_buffer_t
 {
 	stb_fontchar m_font_data[STB_FONT_consolas_24_latin1_NUM_CHARS];
 	VkPipeline m_pipeline;
-	memory_buffer_t m_vertex_buffer;
-	std::vector<text_info_t> m_info;
+	batch_t<glyph_instance_t> m_glyphs;
+};
+
+// VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_POLYGON_MODE_FILL, one instance per composite
+struct composite_instance_t
+{
+	std::array<std::float_t, 4> m_bounds; // pixels the layer's content covers, min x, min y, max x, max y
+	std::float_t m_depth;
+};
+
+template<>
+struct vertex_layout_t<composite_instance_t>
+{
+	static constexpr auto input_rate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	static constexpr auto inputs = std::array<vertex_input_t, 2>{vertex_member(composite_instance_t, m_bounds), vertex_member(composite_instance_t, m_depth)};
+};
+
+struct cached_buffer_t
+{
+	batch_t<composite_instance_t> m_instances;
+	std::vector<std::uint32_t> m_targets; // layer image sampled by each instance
+};
+
+struct cached_layer_t // offscreen layer kept between frames, redrawn only when its inputs change
+{
+	std::string m_name;
+	std::uint32_t m_target; // image in the layer cache
+	std::uint64_t m_digest; // of the inputs it was last drawn from
+	std::array<std::float_t, 4> m_bounds; // pixels its content covers
+	bool m_dirty{true};
+};
+
+struct scene_mark_t // sizes of the frame's buffers when a cached layer began, a clean layer's primitives are dropped back to it
+{
+	std::size_t m_commands;
+	std::size_t m_mesh_vertices;
+	std::size_t m_mesh_depths;
+	std::size_t m_mesh_indices;
+	std::size_t m_mesh_opaque;
+	std::size_t m_mesh_draws;
+	std::size_t m_retained_instances;
+	std::size_t m_retained_draws;
+	std::size_t m_polygon_vertices;
+	std::size_t m_polygon_indices;
+	std::size_t m_polygon_covers;
+	std::size_t m_polygon_draws;
+	std::size_t m_lines;
+	std::size_t m_shapes;
+	std::size_t m_glyphs;
+	std::array<std::uint32_t, 256> m_layer_depths;
+};
+
+enum class draw_kind : std::uint8_t // pipeline field of the sort key, commands of different kinds never merge
+{
+	opaque_mesh, // depth pre-pass, sorts ahead of every layer
+	mesh,
+	retained,
+	polygon,
+	line,
+	shape,
+	text,
+	cached // composite of a cached layer
+};
+
+struct draw_command_t // a range of one kind's buffer, sorted by key in scene_t::end
+{
+	std::uint64_t m_key; // target, layer, submission order, then clip, pipeline, texture and state
+	draw_kind m_kind;
+	std::uint32_t m_first; // first draw or instance in the kind's buffer
+	std::uint32_t m_count;
+	std::uint32_t m_stream{~0u}; // cull stream it's drawn from, ~0 when drawn directly
 };
\ No newline at end of file
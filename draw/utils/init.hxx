@@ -47,12 +47,13 @@ namespace draw
 
 		inline auto device_create_info(
 			const std::vector<VkDeviceQueueCreateInfo>& queue_create_info,
-			const std::vector<const char*>& device_extensions
+			const std::vector<const char*>& device_extensions,
+			const void* enabled_features
 		) -> const VkDeviceCreateInfo
 		{
 			return VkDeviceCreateInfo{
 				VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-				nullptr,
+				enabled_features, // VkPhysicalDeviceFeatures2 chain
 				std::uint32_t{ 0 },
 				static_cast<std::uint32_t>( queue_create_info.size( ) ),
 				queue_create_info.data( ),
@@ -92,10 +93,12 @@ namespace draw
 
 		inline auto swap_chain_create_info(
 			const VkSurfaceKHR surface,
-			bool v_sync,
+			VkPresentModeKHR present_mode,
+			std::uint32_t image_count,
 			VkFormat color_format,
 			VkColorSpaceKHR color_space,
-			VkExtent2D extent
+			VkExtent2D extent,
+			VkSwapchainKHR old_swap_chain = nullptr
 		) -> const VkSwapchainCreateInfoKHR
 		{
 			return VkSwapchainCreateInfoKHR{
@@ -103,7 +106,7 @@ namespace draw
 				nullptr,
 				std::uint32_t{ 0 },
 				surface,
-				std::uint32_t{ v_sync ? 2U : 3U },
+				image_count,
 				color_format,
 				color_space,
 				extent,
@@ -114,15 +117,16 @@ namespace draw
 				nullptr,
 				VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR,
 				VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-				VkPresentModeKHR{ v_sync ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_MAILBOX_KHR },
+				present_mode,
 				std::int32_t{ 1 },
-				nullptr
+				old_swap_chain
 			};
 		}
 
 		inline auto image_view_create_info(
 			const VkImage image,
-			VkFormat color_format
+			VkFormat format,
+			VkImageAspectFlags aspect
 		) -> const VkImageViewCreateInfo
 		{
 			auto components = VkComponentMapping{
@@ -133,7 +137,7 @@ namespace draw
 			};
 
 			auto subresource_range = VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
+				aspect,
 				std::uint32_t{ 0 },
 				std::uint32_t{ 1 },
 				std::uint32_t{ 0 },
@@ -146,7 +150,7 @@ namespace draw
 				std::uint32_t{ 0 },
 				image,
 				VK_IMAGE_VIEW_TYPE_2D,
-				color_format,
+				format,
 				components,
 				subresource_range
 			};
@@ -154,14 +158,15 @@ namespace draw
 
 		inline auto command_buffer_allocate_info(
 			const VkCommandPool command_pool,
-			std::size_t buffer_count
+			std::size_t buffer_count,
+			VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY
 		) -> const VkCommandBufferAllocateInfo
 		{
 			return VkCommandBufferAllocateInfo{
 				VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
 				nullptr,
 				command_pool,
-				VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+				level,
 				static_cast<std::uint32_t>( buffer_count )
 			};
 		}
@@ -225,7 +230,7 @@ namespace draw
 
 		inline auto shader_module_create_info(
 			std::size_t shader_size,
-			std::uint32_t* shader_code
+			const std::uint32_t* shader_code
 		) -> const VkShaderModuleCreateInfo
 		{
 			return VkShaderModuleCreateInfo{
@@ -239,7 +244,8 @@ namespace draw
 
 		inline auto attachment_descriptions(
 			VkFormat color_format,
-			VkFormat depth_format
+			VkFormat depth_format,
+			VkImageLayout color_final_layout
 		) -> const std::array<VkAttachmentDescription, 2>
 		{
 			return std::array<VkAttachmentDescription, 2>{
@@ -252,7 +258,7 @@ namespace draw
 					VK_ATTACHMENT_LOAD_OP_DONT_CARE,
 					VK_ATTACHMENT_STORE_OP_DONT_CARE,
 					VK_IMAGE_LAYOUT_UNDEFINED,
-					VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+					color_final_layout
 				},
 				VkAttachmentDescription{ // depth attachment
 					std::uint32_t{ 0 },
@@ -287,9 +293,12 @@ namespace draw
 			};
 		}
 
-		inline auto subpass_dependencies( ) -> const std::array<VkSubpassDependency, 2>
+		inline auto subpass_dependencies(
+			VkPipelineStageFlags color_dst_stage,
+			VkAccessFlags color_dst_access
+		) -> const std::array<VkSubpassDependency, 3>
 		{
-			return std::array<VkSubpassDependency, 2>{
+			return std::array<VkSubpassDependency, 3>{
 				VkSubpassDependency{
 					std::uint32_t{ ~0U },
 					std::uint32_t{ 0 },
@@ -303,10 +312,19 @@ namespace draw
 					std::uint32_t{ 0 },
 					std::uint32_t{ ~0u },
 					VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-					VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+					color_dst_stage,
 					VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-					VK_ACCESS_MEMORY_READ_BIT,
+					color_dst_access,
 					VK_DEPENDENCY_BY_REGION_BIT
+				},
+				VkSubpassDependency{ // the depth stencil image is shared by every frame in flight
+					std::uint32_t{ ~0U },
+					std::uint32_t{ 0 },
+					VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+					VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+					VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					std::uint32_t{ 0 }
 				}
 			};
 		}
@@ -314,7 +332,7 @@ namespace draw
 		inline auto render_pass_create_info(
 			const std::array<VkAttachmentDescription, 2>& attachments,
 			const VkSubpassDescription& subpass,
-			const std::array<VkSubpassDependency, 2>& dependencies
+			const std::array<VkSubpassDependency, 3>& dependencies
 		) -> const VkRenderPassCreateInfo
 		{
 			return VkRenderPassCreateInfo{
@@ -355,14 +373,45 @@ namespace draw
 			};
 		}
 
-		inline auto pipeline_cache_create_info( ) -> const VkPipelineCacheCreateInfo
+		inline auto viewport(
+			VkExtent2D extent
+		) -> const VkViewport
+		{
+			return VkViewport{
+				std::float_t{ 0.0f },
+				std::float_t{ 0.0f },
+				static_cast<std::float_t>( extent.width ),
+				static_cast<std::float_t>( extent.height ),
+				std::float_t{ 0.0f },
+				std::float_t{ 1.0f }
+			};
+		}
+
+		inline auto query_pool_create_info(
+			VkQueryType type,
+			std::uint32_t count
+		) -> const VkQueryPoolCreateInfo
+		{
+			return VkQueryPoolCreateInfo{
+				VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+				nullptr,
+				std::uint32_t{ 0 },
+				type,
+				count,
+				std::uint32_t{ 0 }
+			};
+		}
+
+		inline auto pipeline_cache_create_info(
+			const std::vector<std::uint8_t>& initial_data
+		) -> const VkPipelineCacheCreateInfo
 		{
 			return VkPipelineCacheCreateInfo{
 				VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
 				nullptr,
 				std::uint32_t{ 0 },
-				std::size_t{ 0 },
-				nullptr
+				initial_data.size( ),
+				initial_data.empty( ) ? nullptr : initial_data.data( )
 			};
 		}
 
@@ -386,12 +435,13 @@ namespace draw
 		}
 
 		inline auto descriptor_set_layout_binding(
+			std::uint32_t binding,
 			VkDescriptorType type,
 			VkShaderStageFlags stage_flags
 		) -> const VkDescriptorSetLayoutBinding
 		{
 			return VkDescriptorSetLayoutBinding{
-				std::uint32_t{ 0 },
+				binding,
 				type,
 				std::uint32_t{ 1 },
 				stage_flags,
@@ -400,20 +450,21 @@ namespace draw
 		}
 
 		inline auto descriptor_set_layout_create_info(
-			const VkDescriptorSetLayoutBinding& layout_b
+			const std::vector<VkDescriptorSetLayoutBinding>& layout_bindings
 		) -> const VkDescriptorSetLayoutCreateInfo
 		{
 			return VkDescriptorSetLayoutCreateInfo{
 				VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
 				nullptr,
 				std::uint32_t{ 0 },
-				std::uint32_t{ 1 },
-				&layout_b
+				static_cast<std::uint32_t>( layout_bindings.size( ) ),
+				layout_bindings.data( )
 			};
 		}
 
 		inline auto pipeline_layout_create_info(
-			const VkDescriptorSetLayout& layout
+			const VkDescriptorSetLayout& layout,
+			const std::vector<VkPushConstantRange>& push_constant_ranges
 		) -> const VkPipelineLayoutCreateInfo
 		{
 			return VkPipelineLayoutCreateInfo{
@@ -422,8 +473,8 @@ namespace draw
 				std::uint32_t{ 0 },
 				std::uint32_t{ 1 },
 				&layout,
-				std::uint32_t{ 0 },
-				nullptr
+				static_cast<std::uint32_t>( push_constant_ranges.size( ) ),
+				push_constant_ranges.data( )
 			};
 		}
 
@@ -438,7 +489,7 @@ namespace draw
 		}
 
 		inline auto descriptor_pool_create_info(
-			const VkDescriptorPoolSize& pool_size
+			const std::vector<VkDescriptorPoolSize>& pool_sizes
 		) -> const VkDescriptorPoolCreateInfo
 		{
 			return VkDescriptorPoolCreateInfo{
@@ -446,8 +497,8 @@ namespace draw
 				nullptr,
 				std::uint32_t{ 0 },
 				std::uint32_t{ 1 },
-				std::uint32_t{ 1 },
-				&pool_size
+				static_cast<std::uint32_t>( pool_sizes.size( ) ),
+				pool_sizes.data( )
 			};
 		}
 
@@ -467,6 +518,7 @@ namespace draw
 
 		inline auto write_descriptor_set(
 			const VkDescriptorSet& set,
+			std::uint32_t binding,
 			VkDescriptorType type,
 			const VkDescriptorBufferInfo& buffer_info
 		) -> const VkWriteDescriptorSet
@@ -475,7 +527,7 @@ namespace draw
 				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
 				nullptr,
 				set,
-				std::uint32_t{ 0 },
+				binding,
 				std::uint32_t{ 0 },
 				std::uint32_t{ 1 },
 				type,
@@ -487,6 +539,7 @@ namespace draw
 
 		inline auto write_descriptor_set(
 			const VkDescriptorSet& set,
+			std::uint32_t binding,
 			VkDescriptorType type,
 			const VkDescriptorImageInfo& image_info
 		) -> const VkWriteDescriptorSet
@@ -495,7 +548,7 @@ namespace draw
 				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
 				nullptr,
 				set,
-				std::uint32_t{ 0 },
+				binding,
 				std::uint32_t{ 0 },
 				std::uint32_t{ 1 },
 				type,
@@ -540,17 +593,20 @@ namespace draw
 			};
 		}
 
-		inline auto pipeline_color_blend_attachment_state( ) -> const VkPipelineColorBlendAttachmentState
+		inline auto pipeline_color_blend_attachment_state(
+			VkColorComponentFlags write_mask,
+			VkBlendFactor src_color_factor
+		) -> const VkPipelineColorBlendAttachmentState
 		{
 			return VkPipelineColorBlendAttachmentState{
 				std::uint32_t{ 1 },
-				VK_BLEND_FACTOR_SRC_ALPHA,
+				src_color_factor,
 				VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
 				VK_BLEND_OP_ADD,
-				VK_BLEND_FACTOR_SRC_ALPHA,
+				VK_BLEND_FACTOR_ONE,
 				VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
 				VK_BLEND_OP_ADD,
-				VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+				write_mask
 			};
 		}
 
@@ -570,6 +626,48 @@ namespace draw
 			};
 		}
 
+		inline auto stencil_op_state(
+			VkStencilOp fail_op,
+			VkStencilOp pass_op,
+			VkStencilOp depth_fail_op,
+			VkCompareOp compare_op
+		) -> const VkStencilOpState
+		{
+			return VkStencilOpState{
+				fail_op,
+				pass_op,
+				depth_fail_op,
+				compare_op,
+				std::uint32_t{ 0xff },
+				std::uint32_t{ 0xff },
+				std::uint32_t{ 0 }
+			};
+		}
+
+		inline auto pipeline_depth_stencil_state_create_info(
+			VkBool32 depth_test,
+			VkBool32 depth_write,
+			VkBool32 stencil_test,
+			const VkStencilOpState& front,
+			const VkStencilOpState& back
+		) -> const VkPipelineDepthStencilStateCreateInfo
+		{
+			return VkPipelineDepthStencilStateCreateInfo{
+				VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+				nullptr,
+				std::uint32_t{ 0 },
+				depth_test,
+				depth_write,
+				VK_COMPARE_OP_LESS_OR_EQUAL,
+				std::uint32_t{ 0 },
+				stencil_test,
+				front,
+				back,
+				std::float_t{ 0.0f },
+				std::float_t{ 1.0f }
+			};
+		}
+
 		inline auto pipeline_dynamic_state_create_info(
 			const std::vector<VkDynamicState>& dynamic_states
 		) -> const VkPipelineDynamicStateCreateInfo
@@ -583,6 +681,20 @@ namespace draw
 			};
 		}
 
+		inline auto pipeline_viewport_state_create_info( ) -> const VkPipelineViewportStateCreateInfo
+		{
+			// viewport and scissor are dynamic, only the counts are baked
+			return VkPipelineViewportStateCreateInfo{
+				VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+				nullptr,
+				std::uint32_t{ 0 },
+				std::uint32_t{ 1 },
+				nullptr,
+				std::uint32_t{ 1 },
+				nullptr
+			};
+		}
+
 		inline auto pipeline_multisample_state_create_info( ) -> const VkPipelineMultisampleStateCreateInfo
 		{
 			return VkPipelineMultisampleStateCreateInfo{
@@ -598,38 +710,48 @@ namespace draw
 			};
 		}
 
-		inline auto vertex_input_binding_description(
-			std::size_t stride_size
-		) -> const VkVertexInputBindingDescription
+		inline auto vertex_input_binding_descriptions(
+			std::span<const vertex_binding_t> binding_infos
+		) -> const std::vector<VkVertexInputBindingDescription>
 		{
-			return VkVertexInputBindingDescription{
-				std::uint32_t{ 0 },
-				static_cast<std::uint32_t>( stride_size ),
-				VK_VERTEX_INPUT_RATE_VERTEX
-			};
+			auto ret = std::vector<VkVertexInputBindingDescription>{ };
+
+			for ( const auto& binding : binding_infos )
+			{
+				ret.push_back( VkVertexInputBindingDescription{
+					static_cast<std::uint32_t>( &binding - binding_infos.data( ) ), // curr index
+					static_cast<std::uint32_t>( binding.m_stride ),
+					binding.m_input_rate
+				} );
+			}
+
+			return ret;
 		}
 
 		inline auto vertex_input_attribute_descriptions(
-			const std::vector<vertex_input_t>& input_infos
+			std::span<const vertex_binding_t> binding_infos
 		) -> const std::vector<VkVertexInputAttributeDescription>
 		{
 			auto ret = std::vector<VkVertexInputAttributeDescription>{ };
 
-			for ( const auto& input : input_infos )
+			for ( const auto& binding : binding_infos )
 			{
-				ret.push_back( VkVertexInputAttributeDescription{
-					static_cast<std::uint32_t>( &input - &input_infos.at( 0 ) ), // curr index
-					std::uint32_t{ 0 },
-					input.m_format,
-					static_cast<std::uint32_t>( input.m_offset )
-				} );
+				for ( const auto& input : binding.m_inputs )
+				{
+					ret.push_back( VkVertexInputAttributeDescription{
+						static_cast<std::uint32_t>( ret.size( ) ), // locations continue across bindings
+						static_cast<std::uint32_t>( &binding - binding_infos.data( ) ),
+						input.m_format,
+						static_cast<std::uint32_t>( input.m_offset )
+					} );
+				}
 			}
 
 			return ret;
 		}
 
 		inline auto pipeline_vertex_input_state_create_info(
-			const VkVertexInputBindingDescription& binding,
+			const std::vector<VkVertexInputBindingDescription>& bindings,
 			const std::vector<VkVertexInputAttributeDescription>& attributes
 		) -> const VkPipelineVertexInputStateCreateInfo
 		{
@@ -637,8 +759,8 @@ namespace draw
 				VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
 				nullptr,
 				std::uint32_t{ 0 },
-				std::uint32_t{ 1 },
-				&binding,
+				static_cast<std::uint32_t>( bindings.size( ) ),
+				bindings.data( ),
 				static_cast<std::uint32_t>( attributes.size( ) ),
 				attributes.data( )
 			};
@@ -676,8 +798,10 @@ namespace draw
 			const std::array<VkPipelineShaderStageCreateInfo, 2>& shader_stages,
 			const VkPipelineVertexInputStateCreateInfo& vertex_input_state,
 			const VkPipelineInputAssemblyStateCreateInfo& input_assembly_state,
+			const VkPipelineViewportStateCreateInfo& viewport_state,
 			const VkPipelineRasterizationStateCreateInfo& rasterization_state,
 			const VkPipelineMultisampleStateCreateInfo& multisample_state,
+			const VkPipelineDepthStencilStateCreateInfo& depth_stencil_state,
 			const VkPipelineColorBlendStateCreateInfo& color_blend_state,
 			const VkPipelineDynamicStateCreateInfo& dynamic_state,
 			const VkPipelineLayout pipeline_layout,
@@ -693,10 +817,10 @@ namespace draw
 				&vertex_input_state,
 				&input_assembly_state,
 				nullptr,
-				nullptr,
+				&viewport_state,
 				&rasterization_state,
 				&multisample_state,
-				nullptr,
+				&depth_stencil_state,
 				&color_blend_state,
 				&dynamic_state,
 				pipeline_layout,
@@ -707,6 +831,44 @@ namespace draw
 			};
 		}
 
+		inline auto compute_pipeline_create_info(
+			const VkShaderModule compute_shader,
+			const std::string& entry_point,
+			const VkPipelineLayout pipeline_layout
+		) -> const VkComputePipelineCreateInfo
+		{
+			return VkComputePipelineCreateInfo{
+				VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+				nullptr,
+				std::uint32_t{ 0 },
+				VkPipelineShaderStageCreateInfo{
+					VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+					nullptr,
+					std::uint32_t{ 0 },
+					VK_SHADER_STAGE_COMPUTE_BIT,
+					compute_shader,
+					entry_point.c_str( ),
+					nullptr
+				},
+				pipeline_layout,
+				nullptr,
+				std::int32_t{ -1 }
+			};
+		}
+
+		inline auto memory_barrier(
+			VkAccessFlags src_access_flag,
+			VkAccessFlags dst_access_flag
+		) -> VkMemoryBarrier
+		{
+			return VkMemoryBarrier{
+				VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+				nullptr,
+				src_access_flag,
+				dst_access_flag
+			};
+		}
+
 		inline auto memory_allocate_info( ) -> const VkMemoryAllocateInfo
 		{
 			return VkMemoryAllocateInfo{
@@ -743,15 +905,52 @@ namespace draw
 			};
 		}
 
+		inline auto buffer_create_info(
+			VkDeviceSize size,
+			VkBufferUsageFlags usage,
+			const std::vector<std::uint32_t>& queue_families
+		) -> const VkBufferCreateInfo
+		{
+			// distinct families, shared without ownership transfers when there is more than one
+			return VkBufferCreateInfo{
+				VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+				nullptr,
+				std::uint32_t{ 0 },
+				size,
+				usage,
+				queue_families.size( ) > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+				static_cast<std::uint32_t>( queue_families.size( ) ),
+				queue_families.data( )
+			};
+		}
+
 		inline auto command_buffer_begin_info(
-			VkCommandBufferUsageFlags flags
+			VkCommandBufferUsageFlags flags,
+			const VkCommandBufferInheritanceInfo* inheritance_info = nullptr
 		) -> const VkCommandBufferBeginInfo
 		{
 			return VkCommandBufferBeginInfo{
 				VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 				nullptr,
 				flags,
-				nullptr
+				inheritance_info
+			};
+		}
+
+		inline auto command_buffer_inheritance_info(
+			const VkRenderPass render_pass,
+			const VkFramebuffer frame_buffer
+		) -> const VkCommandBufferInheritanceInfo
+		{
+			return VkCommandBufferInheritanceInfo{
+				VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+				nullptr,
+				render_pass,
+				0,
+				frame_buffer,
+				VK_FALSE,
+				0,
+				0
 			};
 		}
 
@@ -841,6 +1040,26 @@ namespace draw
 			};
 		}
 
+		inline auto image_blit(
+			VkExtent2D src_extent,
+			VkExtent2D dst_extent
+		) -> VkImageBlit
+		{
+			auto image_layers = VkImageSubresourceLayers{
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				std::uint32_t{ 0 },
+				std::uint32_t{ 0 },
+				std::uint32_t{ 1 }
+			};
+
+			return VkImageBlit{
+				image_layers,
+				{ VkOffset3D{ 0, 0, 0 }, VkOffset3D{ static_cast<std::int32_t>( src_extent.width ), static_cast<std::int32_t>( src_extent.height ), 1 } },
+				image_layers,
+				{ VkOffset3D{ 0, 0, 0 }, VkOffset3D{ static_cast<std::int32_t>( dst_extent.width ), static_cast<std::int32_t>( dst_extent.height ), 1 } }
+			};
+		}
+
 		inline auto sampler_create_info(
 			VkFilter filter
 		) -> VkSamplerCreateInfo
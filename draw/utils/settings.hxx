@@ -5,6 +5,7 @@
 
 #include "containers.hxx"
 #include "constants.hxx"
+#include "../shaders/shaders.hxx"
 #include "../fonts/stb_font_consolas_24_latin1.inl"
 
 namespace draw
@@ -13,68 +14,277 @@ namespace draw
 	{
 		namespace shaders
 		{
-			const auto mesh_vertex = std::string{"mesh.vert.spv"};
-			const auto mesh_fragment = std::string{"mesh.frag.spv"};
+			constexpr auto mesh_vertex = std::span<const std::uint32_t>{spirv::mesh_vertex};
+			constexpr auto mesh_fragment = std::span<const std::uint32_t>{spirv::mesh_fragment};
 
-			const auto text_vertex = std::string{"text.vert.spv" };
-			const auto text_fragment = std::string{"text.frag.spv"};
+			constexpr auto retained_vertex = std::span<const std::uint32_t>{spirv::retained_vertex};
+
+			constexpr auto winding_vertex = std::span<const std::uint32_t>{spirv::winding_vertex};
+			constexpr auto cover_vertex = std::span<const std::uint32_t>{spirv::cover_vertex};
+
+			constexpr auto line_vertex = std::span<const std::uint32_t>{spirv::line_vertex};
+			constexpr auto line_fragment = std::span<const std::uint32_t>{spirv::line_fragment};
+
+			constexpr auto shape_vertex = std::span<const std::uint32_t>{spirv::shape_vertex};
+			constexpr auto shape_fragment = std::span<const std::uint32_t>{spirv::shape_fragment};
+
+			constexpr auto text_vertex = std::span<const std::uint32_t>{spirv::text_vertex};
+			constexpr auto text_fragment = std::span<const std::uint32_t>{spirv::text_fragment};
+
+			constexpr auto composite_vertex = std::span<const std::uint32_t>{spirv::composite_vertex};
+			constexpr auto composite_fragment = std::span<const std::uint32_t>{spirv::composite_fragment};
+
+			constexpr auto cull_compute = std::span<const std::uint32_t>{spirv::cull_compute};
+
+			// every module the renderer creates at startup
+			constexpr auto all = std::array<std::span<const std::uint32_t>, 14>{
+				mesh_vertex, mesh_fragment, retained_vertex, winding_vertex, cover_vertex, line_vertex, line_fragment,
+				shape_vertex, shape_fragment, text_vertex, text_fragment, composite_vertex, composite_fragment, cull_compute
+			};
 
 			const auto entry_point = std::string{"main"};
 		}
 
 		namespace pipelines
 		{
-			const auto mesh = pipeline_setting_t{
+			constexpr auto mesh = pipeline_setting_t{
 				settings::shaders::mesh_vertex,
 				settings::shaders::mesh_fragment,
-				std::size_t{sizeof(vertex_t)},
-				std::vector<vertex_input_t>{
-					vertex_input_t{VK_FORMAT_R32G32_SFLOAT, offsetof(vertex_t, m_pos)},
-					vertex_input_t{VK_FORMAT_R8G8B8A8_UNORM, offsetof(vertex_t, m_col)}
-				},
-				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
-				VK_POLYGON_MODE_FILL
+				vertex_bindings<vertex_t, std::float_t>,
+				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+				VK_POLYGON_MODE_FILL,
+				std::uint32_t{sizeof(push_constants_t)},
+				stencil_mode::none,
+				depth_mode::test_write
 			};
 
-			const auto line = pipeline_setting_t{
+			// translucent meshes blend over what's below them, writing depth would hide later primitives drawn under them
+			constexpr auto translucent_mesh = pipeline_setting_t{
 				settings::shaders::mesh_vertex,
 				settings::shaders::mesh_fragment,
-				std::size_t{sizeof(vertex_t)},
-				std::vector<vertex_input_t>{
-					vertex_input_t{VK_FORMAT_R32G32_SFLOAT, offsetof(vertex_t, m_pos)},
-					vertex_input_t{VK_FORMAT_R8G8B8A8_UNORM, offsetof(vertex_t, m_col)}
-				},
-				VK_PRIMITIVE_TOPOLOGY_LINE_LIST,
-				VK_POLYGON_MODE_LINE
+				vertex_bindings<vertex_t, std::float_t>,
+				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+				VK_POLYGON_MODE_FILL,
+				std::uint32_t{sizeof(push_constants_t)},
+				stencil_mode::none,
+				depth_mode::test
+			};
+
+			constexpr auto retained = pipeline_setting_t{
+				settings::shaders::retained_vertex,
+				settings::shaders::mesh_fragment,
+				vertex_bindings<vertex_t, mesh_instance_t>,
+				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+				VK_POLYGON_MODE_FILL,
+				std::uint32_t{sizeof(push_constants_t)},
+				stencil_mode::none,
+				depth_mode::test
+			};
+
+			constexpr auto polygon_winding = pipeline_setting_t{
+				settings::shaders::winding_vertex,
+				settings::shaders::mesh_fragment,
+				vertex_bindings<vertex_t>,
+				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+				VK_POLYGON_MODE_FILL,
+				std::uint32_t{sizeof(push_constants_t)},
+				stencil_mode::winding
+			};
+
+			constexpr auto polygon_cover = pipeline_setting_t{
+				settings::shaders::cover_vertex,
+				settings::shaders::mesh_fragment,
+				vertex_bindings<polygon_cover_t>,
+				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+				VK_POLYGON_MODE_FILL,
+				std::uint32_t{sizeof(push_constants_t)},
+				stencil_mode::cover,
+				depth_mode::test
 			};
 
-			const auto text = pipeline_setting_t{
+			constexpr auto line = pipeline_setting_t{
+				settings::shaders::line_vertex,
+				settings::shaders::line_fragment,
+				vertex_bindings<line_instance_t>,
+				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+				VK_POLYGON_MODE_FILL,
+				std::uint32_t{sizeof(push_constants_t)},
+				stencil_mode::none,
+				depth_mode::test
+			};
+
+			constexpr auto shape = pipeline_setting_t{
+				settings::shaders::shape_vertex,
+				settings::shaders::shape_fragment,
+				vertex_bindings<shape_instance_t>,
+				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+				VK_POLYGON_MODE_FILL,
+				std::uint32_t{sizeof(push_constants_t)},
+				stencil_mode::none,
+				depth_mode::test
+			};
+
+			constexpr auto text = pipeline_setting_t{
 				settings::shaders::text_vertex,
 				settings::shaders::text_fragment,
-				std::size_t{sizeof(text_vertex_t)},
-				std::vector<vertex_input_t>{
-					vertex_input_t{VK_FORMAT_R32G32_SFLOAT, offsetof(text_vertex_t, m_pos)},
-					vertex_input_t{VK_FORMAT_R32G32_SFLOAT, offsetof(text_vertex_t, m_uv)},
-					vertex_input_t{VK_FORMAT_R8G8B8A8_UNORM, offsetof(text_vertex_t, m_col)}
-				},
+				vertex_bindings<glyph_instance_t>,
 				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
-				VK_POLYGON_MODE_FILL
+				VK_POLYGON_MODE_FILL,
+				std::uint32_t{sizeof(push_constants_t)},
+				stencil_mode::none,
+				depth_mode::test
+			};
+
+			constexpr auto composite = pipeline_setting_t{
+				settings::shaders::composite_vertex,
+				settings::shaders::composite_fragment,
+				vertex_bindings<composite_instance_t>,
+				VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+				VK_POLYGON_MODE_FILL,
+				std::uint32_t{sizeof(push_constants_t)},
+				stencil_mode::none,
+				depth_mode::test,
+				blend_mode::premultiplied,
+				true
 			};
 		}
 		
+		namespace ring
+		{
+			constexpr auto min_size = VkDeviceSize{64 * 1024}; // per frame region
+			constexpr auto alignment = VkDeviceSize{16};
+			constexpr auto shrink_ratio = VkDeviceSize{4}; // shrink once usage drops under a quarter
+			constexpr auto shrink_frames = std::uint32_t{600}; // ... for this many frames in a row
+		}
+
+		namespace antialias
+		{
+			constexpr auto feather = std::float_t{1.0f}; // pixels, centered on the edge
+			constexpr auto max_miter = std::float_t{4.0f}; // feather widths a sharp mesh corner may reach out
+		}
+
+		namespace depth
+		{
+			constexpr auto layer_primitives = std::uint32_t{65536}; // per layer before they share a depth
+			constexpr auto step = std::float_t{1.0f / 16777216.0f}; // 256 layers of layer_primitives, exact in a 32 bit float
+		}
+
+		namespace sort_key
+		{
+			constexpr auto target_shift = std::uint32_t{60}; // 4 bits, cached layers render before the swap chain
+			constexpr auto layer_shift = std::uint32_t{52};
+			constexpr auto order_shift = std::uint32_t{28}; // 24 bits, primitives of a layer are painted in submission order
+			constexpr auto clip_shift = std::uint32_t{16}; // 12 bits, below the order, a new clip splits merges but never reorders
+			constexpr auto kind_shift = std::uint32_t{12};
+			constexpr auto texture_shift = std::uint32_t{8};
+			constexpr auto state_shift = std::uint32_t{0};
+			constexpr auto state_mask = ~(std::uint64_t{0xffffff} << order_shift); // commands equal under the mask can be merged
+
+			constexpr auto target_mask = std::uint64_t{0xf};
+			constexpr auto clip_mask = std::uint64_t{0xfff};
+			constexpr auto screen_target = std::uint32_t{15}; // 0 to 14 are cached layers
+			constexpr auto max_clips = std::uint32_t{4095}; // per frame, 0 is unclipped, further pushes keep the enclosing clip
+			constexpr auto font_texture = std::uint8_t{1}; // 0 for pipelines without a texture, 4 bits
+		}
+
+		namespace layer_cache
+		{
+			constexpr auto max_layers = std::uint32_t{15}; // one per target below sort_key::screen_target
+			constexpr auto usage = VkImageUsageFlags{VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT};
+			constexpr auto clear_color = VkClearColorValue{0.0f, 0.0f, 0.0f, 0.0f}; // transparent where nothing was drawn
+		}
+
+		namespace memory
+		{
+			constexpr auto block_size = VkDeviceSize{64 * 1024 * 1024}; // per vkAllocateMemory, larger requests get a block of their own size
+			constexpr auto linear_block_size = VkDeviceSize{16 * 1024 * 1024}; // staging
+			constexpr auto dedicated_size = VkDeviceSize{16 * 1024 * 1024}; // images from here up skip the blocks
+		}
+
+		namespace upload
+		{
+			constexpr auto staging_size = VkDeviceSize{8 * 1024 * 1024}; // ring, larger uploads get a staging buffer of their own
+			constexpr auto alignment = VkDeviceSize{16}; // covers every texel size copied out of the ring
+			constexpr auto wait_stage = VkPipelineStageFlags{VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT};
+		}
+
+		namespace pipeline_cache
+		{
+			const auto file_name = std::string{"pipeline.cache"}; // next to the executable, rewritten on shutdown
+			constexpr auto magic = std::uint32_t{0x48435044}; // "DPCH"
+		}
+
+		namespace startup
+		{
+			constexpr auto max_threads = std::uint32_t{4}; // calling thread included, capped by the hardware
+			constexpr auto lazy_pipelines = false; // graphics pipelines compile on first bind instead of during startup
+			constexpr auto report = false; // per step timings and time to first frame on stdout, off unless profiling startup
+		}
+
+		namespace present
+		{
+			constexpr auto mode = present_mode::mailbox; // at startup, switchable at runtime
+			constexpr auto pacing = false; // waits for the previous present before acquiring, needs VK_KHR_present_wait
+			constexpr auto frame_limits = std::array<std::uint32_t, 3>{0, 60, 144}; // frame caps cycled through by the demo, 0 is none
+		}
+
+		namespace damage
+		{
+			constexpr auto skip_idle = true; // a frame hashing like the last presented one is neither recorded nor presented
+			constexpr auto tile_size = std::uint32_t{64}; // pixels, granularity of the damage rects
+			constexpr auto max_rects = std::size_t{32}; // more than this and the whole image is presented
+			// under mailbox the rects of presents not yet known to be shown are carried into the next ones,
+			// which needs VK_KHR_present_wait, without it mailbox presents whole images
+			constexpr auto idle_wait = std::uint32_t{250}; // milliseconds the demo sleeps on input after a skipped frame
+		}
+
+		namespace resolution
+		{
+			constexpr auto dynamic = false; // renders offscreen at a scale that holds target_time, upscaled into the swap chain
+			constexpr auto target_time = std::float_t{8.0f}; // gpu milliseconds per frame
+			constexpr auto headroom = std::float_t{0.8f}; // of target_time, the scale only grows back below it
+			constexpr auto min_scale = std::float_t{0.5f};
+			constexpr auto scale_step = std::float_t{0.05f}; // every change redraws the cached layers
+			constexpr auto smoothing = std::float_t{0.1f}; // weight of the newest gpu time
+			constexpr auto offscreen_usage = VkImageUsageFlags{VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT};
+		}
+
+		namespace recording
+		{
+			constexpr auto max_threads = std::uint32_t{16}; // calling thread included, capped by the hardware
+			constexpr auto min_commands = std::size_t{256}; // per secondary command buffer, smaller passes are recorded inline
+		}
+
+		namespace mesh_pool
+		{
+			constexpr auto min_size = VkDeviceSize{256 * 1024}; // per buffer, doubles when full
+			constexpr auto vertex_usage = VkBufferUsageFlags{VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT};
+			constexpr auto index_usage = VkBufferUsageFlags{VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT};
+		}
+
+		namespace culling
+		{
+			constexpr auto group_size = std::uint32_t{256}; // keep in sync with cull.comp
+			constexpr auto command_size = VkDeviceSize{16}; // indirect command slot in front of each stream
+			constexpr auto min_size = VkDeviceSize{256 * 1024}; // per frame, doubles when full
+			constexpr auto usage = VkBufferUsageFlags{VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT};
+		}
+
 		namespace font
 		{
 			constexpr auto extent = VkExtent2D{STB_FONT_consolas_24_latin1_BITMAP_WIDTH, STB_FONT_consolas_24_latin1_BITMAP_HEIGHT_POW2};
 			constexpr auto first_char = std::uint32_t{STB_FONT_consolas_24_latin1_FIRST_CHAR};
+			constexpr auto num_chars = std::uint32_t{STB_FONT_consolas_24_latin1_NUM_CHARS}; // keep in sync with text.vert
+			constexpr auto glyph_box = std::array<std::float_t, 4>{-4.0f, -32.0f, 32.0f, 12.0f}; // conservative bounds around the pen position per unit of scale, also pushed to cull.comp
 		}
 
 		const auto instance_extensions = std::vector<const char*>{VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_WIN32_SURFACE_EXTENSION_NAME};
 		const auto device_extensions = std::vector<const char*>{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-		const auto pipeline_dynamic_states = std::vector<VkDynamicState>{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_LINE_WIDTH};
+		const auto pipeline_dynamic_states = std::vector<VkDynamicState>{VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
 		
+		constexpr auto frames_in_flight = std::uint32_t{2}; // 2 or 3, frames the cpu may record ahead of the gpu
 		constexpr auto api_version = std::uint32_t{VK_API_VERSION_1_2};
 		constexpr auto queue_priority = std::float_t{0.0f};
-		constexpr auto vertex_buffer_offset = VkDeviceSize{0};
 
 		constexpr auto pass_color = VkClearColorValue{0.0f, 0.0f, 0.1f, 1.0f};
 		constexpr auto pass_depth = VkClearDepthStencilValue{1.0f, 0};
@@ -83,14 +293,5 @@ namespace draw
 		constexpr auto color_format = VkFormat{VK_FORMAT_B8G8R8A8_UNORM};
 		constexpr auto color_space = VkColorSpaceKHR{VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
 		constexpr auto stage_mask = VkPipelineStageFlags{VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-
-		const auto viewport = VkViewport{
-			std::float_t{0.0f},
-			std::float_t{0.0f},
-			static_cast<std::float_t>(window::res_vk.width),
-			static_cast<std::float_t>(window::res_vk.height),
-			std::float_t{0.0f},
-			std::float_t{1.0f}
-		};
 	}
 }
\ No newline at end of file
@@ -3,6 +3,12 @@
 #include <chrono>
 #include <cstdint>
 #include <cmath>
+#include <thread>
+#include <algorithm>
+#include <windows.h>
+#include <timeapi.h>
+
+#pragma comment(lib, "winmm.lib")
 
 class timer_t
 {
@@ -12,11 +18,39 @@ class timer_t
 
 	std::double_t m_delta{0.0};
 	std::chrono::steady_clock::time_point m_delta_update{};
+
+	std::uint32_t m_frame_limit{0};
+	std::chrono::steady_clock::duration m_frame_period{};
+	std::chrono::steady_clock::time_point m_frame_deadline{};
+
+	HANDLE m_wait_timer{nullptr};
+	bool m_high_resolution{false}; // otherwise the wait is only as fine as the system timer period
+	bool m_raised_period{false}; // timeBeginPeriod(1) is held while a limit is set
+
+	static constexpr auto spin_slack = std::chrono::microseconds(1000); // woken this far ahead of the deadline, the most that is ever spun
 	
 public:
 
 	timer_t()
-		: m_delta_update{std::chrono::steady_clock::now()} { }
+		: m_delta_update{std::chrono::steady_clock::now()}
+	{
+		// sub millisecond waits without touching the system wide timer period, windows 10 1803 and later
+		m_wait_timer = ::CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		m_high_resolution = m_wait_timer != nullptr;
+
+		if (!m_wait_timer)
+			m_wait_timer = ::CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+	}
+
+	~timer_t()
+	{
+		this->set_frame_limit(0);
+
+		if (m_wait_timer) ::CloseHandle(m_wait_timer);
+	}
+
+	timer_t(const timer_t&) = delete;
+	auto operator=(const timer_t&) -> timer_t& = delete;
 
 	auto update() -> void
 	{
@@ -35,6 +69,54 @@ public:
 		}
 	}
 
+	// 0 disables the limit
+	auto set_frame_limit(std::uint32_t fps) -> void
+	{
+		m_frame_limit = fps;
+		m_frame_period = fps ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / fps : std::chrono::steady_clock::duration{};
+		m_frame_deadline = std::chrono::steady_clock::now() + m_frame_period;
+
+		// the default 15.6 ms period would wake a plain waitable timer most of a frame late, raised only while limiting
+		auto raise = fps && !m_high_resolution;
+		if (raise == m_raised_period)
+			return;
+
+		if (raise) ::timeBeginPeriod(1);
+		else ::timeEndPeriod(1);
+
+		m_raised_period = raise;
+	}
+
+	// one wait up to just before the deadline, then spins what the timer can't resolve
+	auto limit() -> void
+	{
+		if (!m_frame_limit)
+			return;
+
+		if (auto remaining = m_frame_deadline - std::chrono::steady_clock::now(); remaining > spin_slack)
+		{
+			// relative due time in 100 ns units
+			auto due = LARGE_INTEGER{};
+			due.QuadPart = -std::chrono::duration_cast<std::chrono::duration<long long, std::ratio<1, 10000000>>>(remaining - spin_slack).count();
+
+			if (m_wait_timer && ::SetWaitableTimer(m_wait_timer, &due, 0, nullptr, nullptr, FALSE))
+				::WaitForSingleObject(m_wait_timer, INFINITE);
+			else
+				std::this_thread::sleep_for(remaining - spin_slack);
+		}
+
+		// bounded by spin_slack, a late wake up is never stretched by spinning
+		for (; std::chrono::steady_clock::now() < m_frame_deadline; )
+			std::this_thread::yield();
+
+		// keep the cadence, a frame running late starts a new schedule instead of rushing to catch up
+		m_frame_deadline += m_frame_period;
+		if (auto now = std::chrono::steady_clock::now(); m_frame_deadline < now)
+			m_frame_deadline = now + m_frame_period;
+	}
+
+	auto get_frame_limit() -> std::uint32_t { return m_frame_limit; };
+
 	auto get_delta() -> std::double_t { return m_delta; };
 
 	auto get_fps() -> std::uint32_t { return m_fps; };
@@ -12,11 +12,23 @@ auto __stdcall WinMain(HINSTANCE instance, HINSTANCE prev_instance, char* cmd_li
 
 	for (; window.handle_message(); )
 	{
+		// nothing to present to while the client area is empty
+		if (window.is_minimized())
+		{
+			window.wait_message(INFINITE);
+			continue;
+		}
+
 		scene.begin();
 
 		demo.render(scene, timer);
 		
-		scene.end();
+		auto changed = scene.end();
+		timer.limit();
 		timer.update();
+
+		// the screen didn't change, sleep until there is input or the timeout passed
+		if (!changed)
+			window.wait_message(draw::settings::damage::idle_wait);
 	}
 }
\ No newline at end of file
@@ -55,7 +55,7 @@ auto window_t::register_class(const std::string& class_name) -> void
 auto window_t::create_window(HINSTANCE instance, const std::string& window_name, const std::string& class_name) -> void
 {
 	auto ws_ex_style = 0;
-	auto ws_style = WS_OVERLAPPED | WS_CAPTION | WS_SYSMENU | WS_VISIBLE;
+	auto ws_style = WS_OVERLAPPEDWINDOW | WS_VISIBLE; // resizable, the renderer follows the client area
 
 	m_window_handle = ::CreateWindowExA(
 		ws_ex_style,
@@ -102,6 +102,16 @@ auto window_t::handle_message() -> bool
 	return 1;
 }
 
+auto window_t::is_minimized() -> bool
+{
+	return ::IsIconic(m_window_handle);
+}
+
+auto window_t::wait_message(std::uint32_t timeout) -> void
+{
+	::MsgWaitForMultipleObjects(0, nullptr, FALSE, timeout, QS_ALLINPUT);
+}
+
 auto window_t::get_hwnd() -> const HWND
 {
 	return m_window_handle;
@@ -26,6 +26,11 @@ private:
 public:
 
 	auto handle_message() -> bool;
+
+	auto is_minimized() -> bool;
+
+	// returns early on input, nothing is removed from the queue
+	auto wait_message(std::uint32_t timeout) -> void;
 	
 	auto get_hwnd() -> const HWND;
 };
\ No newline at end of file